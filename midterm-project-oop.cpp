@@ -1,33 +1,139 @@
 #include <iostream>
 #include <iomanip>
 #include <cctype>
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cstddef>
+#include <cerrno>
+#include <string_view>
+#include <deque>
+#include <csignal>
+#include <variant>
+#include <tuple>
+#include <ctime>
+#include <charconv>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <malloc.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INVENTORY_HAVE_AVX2 1
+#endif
 
 using namespace std;
 
 // Function to convert string to lowercase
-string toLowerCase(const string &str) {
-    string lowerStr = str;
+string toLowerCase(string_view str) {
+    string lowerStr(str);
     for (char &c : lowerStr) {
         c = tolower(c);
     }
     return lowerStr;
 }
 
+// Function to compare two strings ignoring case, without making lowercase copies
+int compareIgnoreCase(string_view a, string_view b) {
+    size_t n = min(a.size(), b.size());
+    for (size_t i = 0; i < n; i++) {
+        int ca = tolower((unsigned char)a[i]);
+        int cb = tolower((unsigned char)b[i]);
+        if (ca != cb) return ca < cb ? -1 : 1;
+    }
+    if (a.size() == b.size()) return 0;
+    return a.size() < b.size() ? -1 : 1;
+}
+
+// Function to check whether a string starts with a prefix, ignoring case
+bool startsWithIgnoreCase(string_view text, string_view prefix) {
+    return text.size() >= prefix.size() && compareIgnoreCase(text.substr(0, prefix.size()), prefix) == 0;
+}
+
+// Function to check whether a string contains a piece of text, ignoring case
+bool containsIgnoreCase(string_view text, string_view part) {
+    auto equal = [](char a, char b) { return tolower((unsigned char)a) == tolower((unsigned char)b); };
+    return search(text.begin(), text.end(), part.begin(), part.end(), equal) != text.end();
+}
+
 // Function to validate integer input (for quantity)
-bool isValidInteger(const string& input) {
+bool isValidInteger(string_view input) {
     for (char c : input) {
-        if (!isdigit(c)) { // Ensure all characters are digits
+        if (!isdigit((unsigned char)c)) { // Ensure all characters are digits
             return false;
         }
     }
     return !input.empty(); // Return true if the string is not empty
 }
 
+// Function to parse a whole number that fits in an int (a quantity, a threshold)
+bool parseCount(string_view input, int &value) {
+    return isValidInteger(input) && from_chars(input.data(), input.data() + input.size(), value).ec == errc();
+}
+
+// Function to parse a stock change such as "+10" or "-3"
+bool parseDelta(string_view input, int &delta) {
+    bool negative = !input.empty() && input[0] == '-';
+    if (!input.empty() && (input[0] == '+' || input[0] == '-')) input.remove_prefix(1);
+    long long value;
+    if (!isValidInteger(input) || from_chars(input.data(), input.data() + input.size(), value).ec != errc()) {
+        return false;
+    }
+    if (negative) value = -value;
+    if (value < INT32_MIN || value > INT32_MAX) return false;
+    delta = (int)value;
+    return true;
+}
+
+// Function to split a command line into words; double quotes group words
+// containing spaces, e.g.  add Clothing S1 "Red shirt" 10 250
+void splitCommand(const string &line, vector<string> &words) {
+    words.clear();
+    size_t i = 0;
+    while (true) {
+        while (i < line.size() && isspace((unsigned char)line[i])) i++;
+        if (i >= line.size()) break;
+        string word;
+        if (line[i] == '"') {
+            for (i++; i < line.size() && line[i] != '"'; i++) word += line[i];
+            i++; // Closing quote
+        } else {
+            for (; i < line.size() && !isspace((unsigned char)line[i]); i++) word += line[i];
+        }
+        words.push_back(word);
+    }
+}
+
 // Function to validate float input (for price)
-bool isValidFloat(const string& input) {
+bool isValidFloat(string_view input) {
     bool hasDot = false;
     for (char c : input) {
-        if (!isdigit(c)) {
+        if (!isdigit((unsigned char)c)) {
             if (c == '.' && !hasDot) {
                 hasDot = true; // Allow only one decimal point
             } else {
@@ -38,21 +144,103 @@ bool isValidFloat(const string& input) {
     return !input.empty(); // Return true if the string is not empty
 }
 
+// Prices are kept as a whole number of centavos, so comparing, sorting and
+// summing them is exact integer arithmetic
+typedef int64_t Money;
+
+const Money MONEY_LIMIT = 1000000000000000LL; // Largest price accepted from text, in centavos
+
+// Function to parse a price such as "12", "12.5" or "12.345" into centavos.
+// Digits past the centavos are rounded half up. Returns false if the text is
+// not a plain decimal number or is too large.
+bool parseMoney(string_view text, Money &amount) {
+    if (!isValidFloat(text) || text == ".") return false;
+    size_t dot = text.find('.');
+    string_view whole = text.substr(0, dot);
+    string_view fraction = dot == string_view::npos ? string_view() : text.substr(dot + 1);
+    Money value = 0;
+    for (char c : whole) {
+        value = value * 10 + (c - '0');
+        if (value > MONEY_LIMIT / 100) return false;
+    }
+    value *= 100;
+    if (fraction.size() > 0) value += (fraction[0] - '0') * 10;
+    if (fraction.size() > 1) value += fraction[1] - '0';
+    if (fraction.size() > 2 && fraction[2] >= '5') value++;
+    amount = value;
+    return true;
+}
+
+// Write an amount as "pesos.centavos" (e.g. 1250 -> "12.50"); returns the end of the text.
+// The buffer needs room for 24 characters.
+char *formatMoney(char *first, Money amount) {
+    uint64_t magnitude = amount < 0 ? 0 - (uint64_t)amount : (uint64_t)amount;
+    if (amount < 0) *first++ = '-';
+    first = to_chars(first, first + 21, magnitude / 100).ptr;
+    *first++ = '.';
+    *first++ = (char)('0' + magnitude % 100 / 10);
+    *first++ = (char)('0' + magnitude % 10);
+    return first;
+}
+
+string moneyToString(Money amount) {
+    char text[24];
+    return string(text, formatMoney(text, amount));
+}
+
 void clearInput() {
     cin.clear();
     cin.ignore();
 }
 
-// Abstract base class for Items
+// Append-only storage for many small strings. Each string is copied into a
+// large shared block and handed back as a string_view, so storing one costs no
+// allocation of its own. The views stay valid until the arena is destroyed.
+class StringArena {
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    vector<unique_ptr<char[]>> blocks;
+    size_t blockSize = 0; // Size of the last block
+    size_t blockFree = 0; // Bytes left in it
+    size_t used = 0;      // Bytes handed out
+    size_t allocated = 0; // Bytes in all blocks
+
+public:
+    string_view store(string_view text) {
+        if (text.empty()) return string_view();
+        if (text.size() > blockFree) {
+            size_t size = max(BLOCK_SIZE, text.size());
+            blocks.emplace_back(new char[size]);
+            blockSize = blockFree = size;
+            allocated += size;
+        }
+        char *copy = blocks.back().get() + (blockSize - blockFree);
+        memcpy(copy, text.data(), text.size());
+        blockFree -= text.size();
+        used += text.size();
+        return string_view(copy, text.size());
+    }
+
+    size_t bytesUsed() const { return used; }
+    size_t bytesAllocated() const { return allocated; }
+};
+
+// Base class for Items with the fields every kind of item has. The strings
+// are views; whoever creates the item keeps the characters alive (in the
+// inventory, its ItemStore's arena). There are no virtual functions, so items
+// carry no vtable pointer: the details of perishable, electronic and clothing
+// items live in per-kind pools in the ItemStore (see ItemKind).
 class Item {
 private:
-    string id, name, category;
+    string_view id, name, category;
+    string_view lowerId; // id folded to lowercase, the key for lookups
     int quantity;
-    float price;
+    Money price; // Centavos
+
+protected:
+    Item() {} // Only derived classes are created
 
 public:
-    // Pure virtual function to enforce implementation in derived classes
-    virtual void setItem(string itemId, string itemName, int itemQuantity, float itemPrice, string itemCategory) = 0;
 
     // Set item quantity with validation
     void setQuantity(int newQuantity) {
@@ -64,7 +252,7 @@ public:
     }
 
     // Set item price with validation
-    void setPrice(float newPrice) {
+    void setPrice(Money newPrice) {
         if (newPrice >= 0) {
             price = newPrice;
         } else {
@@ -72,13 +260,14 @@ public:
         }
     }
 
-    string getId() { return id; }
-    string getName() { return name; }
-    int getQuantity() { return quantity; }
-    float getPrice() { return price; }
-    string getCategory() { return category; }
+    string_view getId() const { return id; }
+    string_view getLowerId() const { return lowerId; }
+    string_view getName() const { return name; }
+    int getQuantity() const { return quantity; }
+    Money getPrice() const { return price; }
+    string_view getCategory() const { return category; }
 
-    void updatePrice(float newPrice) {
+    void updatePrice(Money newPrice) {
         price = newPrice;
     }
 
@@ -86,15 +275,18 @@ public:
         quantity = newQuantity;
     }
 
-    void setId(string itemId) { id = itemId; }
-    void setName(string itemName) { name = itemName; }
-    void setCategory(string itemCategory) { category = itemCategory; }
+    void setId(string_view itemId) { id = itemId; }
+    void setLowerId(string_view itemLowerId) { lowerId = itemLowerId; }
+    void setName(string_view itemName) { name = itemName; }
+    void setCategory(string_view itemCategory) { category = itemCategory; }
 };
 
-// Derived class for general Item
+// Item as kept by the ItemStore. Items of every kind use it for their common
+// fields; the fields of a specific kind are kept in that kind's pool.
 class GeneralItem : public Item {
 public:
-    void setItem(string itemId, string itemName, int itemQuantity, float itemPrice, string itemCategory) override {
+    void setItem(string_view itemId, string_view itemName, int itemQuantity, Money itemPrice,
+                 string_view itemCategory) {
         setId(itemId);
         setName(itemName);
         setQuantity(itemQuantity);
@@ -103,495 +295,7377 @@ public:
     }
 };
 
-class Inventory {
-private:
-    GeneralItem items[1000]; // Assuming a maximum of 1000 items
-    int itemCount = 0;
+// Kinds of item. General items have only the common fields; each other kind
+// has a details struct of its own, stored in a pool holding only that kind.
+enum ItemKind : uint8_t { KIND_GENERAL, KIND_PERISHABLE, KIND_ELECTRONIC, KIND_CLOTHING, KIND_COUNT };
 
-public:
-    Inventory() : itemCount(0) {}
+struct PerishableDetails {
+    static constexpr ItemKind KIND = KIND_PERISHABLE;
+    int32_t expiryDay; // Days since 1970-01-01
+};
+
+struct ElectronicDetails {
+    static constexpr ItemKind KIND = KIND_ELECTRONIC;
+    string_view serial;
+};
+
+struct ClothingDetails {
+    static constexpr ItemKind KIND = KIND_CLOTHING;
+    string_view size;
+};
+
+// Any kind's details as one value, for adding items and reading them back.
+// The alternatives are in ItemKind order, so index() is the kind.
+typedef variant<monostate, PerishableDetails, ElectronicDetails, ClothingDetails> ItemDetails;
 
-    int getCategoryChoice() {
-    cout << "\n1 - Clothing\n2 - Electronics\n3 - Entertainment\n4 - Return to Main Menu\n";
-    string categoryChoiceInput; // Use a string to read input first
-    cout << "\nEnter Category: ";
-    cin >> categoryChoiceInput; // Read input as string
+// Days since 1970-01-01 of a date in the Gregorian calendar
+int32_t daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
 
-    // Validate the input before converting to integer
-    if (!isValidInteger(categoryChoiceInput)) {
-        cout << "\nInvalid input! Please enter a number." << endl;
-        clearInput(); // Clear the input buffer
-        return -1; // Return -1 to indicate invalid input
+// Function to parse a date written as YYYY-MM-DD
+bool parseDate(string_view text, int32_t &days) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+    int year, month, day;
+    if (!isValidInteger(text.substr(0, 4)) || !isValidInteger(text.substr(5, 2)) || !isValidInteger(text.substr(8, 2))) {
+        return false;
     }
+    from_chars(text.data(), text.data() + 4, year);
+    from_chars(text.data() + 5, text.data() + 7, month);
+    from_chars(text.data() + 8, text.data() + 10, day);
+    static const int monthDays[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12 || day < 1 || day > monthDays[month - 1]) return false;
+    if (month == 2 && day == 29 && !(year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))) return false;
+    days = daysFromCivil(year, month, day);
+    return true;
+}
+
+string formatDate(int32_t days) {
+    days += 719468;
+    int era = (days >= 0 ? days : days - 146096) / 146097;
+    int dayOfEra = days - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int shiftedMonth = (5 * dayOfYear + 2) / 153;
+    int day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+    int month = shiftedMonth + (shiftedMonth < 10 ? 3 : -9);
+    int year = yearOfEra + era * 400 + (month <= 2);
+    char text[32];
+    snprintf(text, sizeof(text), "%04d-%02d-%02d", year, month, day);
+    return text;
+}
 
-    // Convert the valid string input to integer
-    int categoryChoice = stoi(categoryChoiceInput); 
+// Today's date (UTC) as days since 1970-01-01
+int32_t today() {
+    return (int32_t)(time(nullptr) / 86400);
+}
 
-    // Validate the range of categoryChoice
-    if (categoryChoice < 1 || categoryChoice > 4) {
-        cout << "\nCategory " << categoryChoice << " does not exist! Please try again.\n";
-        return -1; // Return -1 for invalid category choice
+// Function to parse a UTC time written as YYYY-MM-DDTHH:MM:SS, into seconds since 1970-01-01
+bool parseTime(string_view text, int64_t &seconds) {
+    int32_t days;
+    if (text.size() != 19 || text[10] != 'T' || text[13] != ':' || text[16] != ':' || !parseDate(text.substr(0, 10), days)) {
+        return false;
+    }
+    int fields[3];
+    for (int f = 0; f < 3; f++) {
+        string_view digits = text.substr(11 + 3 * f, 2);
+        if (!isValidInteger(digits)) return false;
+        from_chars(digits.data(), digits.data() + 2, fields[f]);
     }
+    if (fields[0] > 23 || fields[1] > 59 || fields[2] > 59) return false;
+    seconds = (int64_t)days * 86400 + fields[0] * 3600 + fields[1] * 60 + fields[2];
+    return true;
+}
 
-    return categoryChoice; // Return the valid category choice
+string formatTime(int64_t seconds) {
+    int64_t days = seconds >= 0 ? seconds / 86400 : (seconds - 86399) / 86400;
+    int secondOfDay = (int)(seconds - days * 86400);
+    char text[32];
+    snprintf(text, sizeof(text), "T%02d:%02d:%02d", secondOfDay / 3600, secondOfDay / 60 % 60, secondOfDay % 60);
+    return formatDate((int32_t)days) + text;
 }
 
-    void printItemHeader() {
-        cout << "\n------------------------------------------------------------------------------------------------------------\n";
-        cout << left << setw(20) << "ID" << setw(20) << "Name" << setw(20) << "Quantity" << setw(20) << "Price" << setw(20) << "Category" << endl;
-        cout << "------------------------------------------------------------------------------------------------------------\n";
+// Append an item's details in their text form: nothing for general items,
+// otherwise "expires=YYYY-MM-DD", "serial=<serial>" or "size=<size>"
+void appendDetails(string &out, const ItemDetails &details) {
+    switch (details.index()) {
+        case KIND_PERISHABLE:
+            out += "expires=";
+            out += formatDate(get<PerishableDetails>(details).expiryDay);
+            break;
+        case KIND_ELECTRONIC:
+            out += "serial=";
+            out += get<ElectronicDetails>(details).serial;
+            break;
+        case KIND_CLOTHING:
+            out += "size=";
+            out += get<ClothingDetails>(details).size;
+            break;
     }
+}
 
-    void addItem() {
-        cout << "\n===================== Add Item =====================\n";
-        int categoryChoice = getCategoryChoice();
-        if (categoryChoice == 4) return; // Handle return to main menu
+string formatDetails(const ItemDetails &details) {
+    string text;
+    appendDetails(text, details);
+    return text;
+}
 
-        string category;
-        switch (categoryChoice) {
-            case 1: category = "Clothing"; break;
-            case 2: category = "Electronics"; break;
-            case 3: category = "Entertainment"; break;
-            default:
-                cout << "Category " << categoryChoice << " does not exist! Please try again.\n";
-            return;
-        }
+// Parse the text form written by appendDetails; an empty text is a general
+// item. String fields of the result point into text.
+bool parseDetails(string_view text, ItemDetails &details) {
+    size_t equals = text.find('=');
+    string_view key = text.substr(0, equals), value = equals == string_view::npos ? "" : text.substr(equals + 1);
+    if (text.empty()) {
+        details = monostate();
+    } else if (equals == string_view::npos || value.empty()) {
+        return false;
+    } else if (compareIgnoreCase(key, "expires") == 0) {
+        PerishableDetails perishable;
+        if (!parseDate(value, perishable.expiryDay)) return false;
+        details = perishable;
+    } else if (compareIgnoreCase(key, "serial") == 0) {
+        details = ElectronicDetails{value};
+    } else if (compareIgnoreCase(key, "size") == 0) {
+        details = ClothingDetails{value};
+    } else {
+        return false;
+    }
+    return true;
+}
 
-        string id, name, quantityInput, priceInput;
-        int quantity;
-        float price;
+// Filter kernels over numeric columns. Each kernel writes a selection bitmap:
+// bit (i % 64) of word (i / 64) is set when row i matches. Rows past n in the
+// last word are left clear. AVX2 versions are picked at runtime when the CPU
+// supports them.
+void filterLessEqualScalar(const int32_t *values, int n, int32_t limit, uint64_t *bits) {
+    for (int w = 0; w * 64 < n; w++) {
+        uint64_t word = 0;
+        int end = min(64, n - w * 64);
+        for (int b = 0; b < end; b++) {
+            word |= (uint64_t)(values[w * 64 + b] <= limit) << b;
+        }
+        bits[w] = word;
+    }
+}
 
-        cout << "Enter Item ID: ";
-        clearInput(); 
-        getline(cin, id);
+void filterRangeScalar(const Money *values, int n, Money low, Money high, uint64_t *bits) {
+    for (int w = 0; w * 64 < n; w++) {
+        uint64_t word = 0;
+        int end = min(64, n - w * 64);
+        for (int b = 0; b < end; b++) {
+            Money v = values[w * 64 + b];
+            word |= (uint64_t)(v >= low && v <= high) << b;
+        }
+        bits[w] = word;
+    }
+}
 
-        cout << "Enter Item Name: ";
-        getline(cin, name);
+void filterEqualScalar(const uint16_t *values, int n, uint16_t code, uint64_t *bits) {
+    for (int w = 0; w * 64 < n; w++) {
+        uint64_t word = 0;
+        int end = min(64, n - w * 64);
+        for (int b = 0; b < end; b++) {
+            word |= (uint64_t)(values[w * 64 + b] == code) << b;
+        }
+        bits[w] = word;
+    }
+}
 
-        // Validate Item Quantity input (integer)
-        cout << "Enter Item Quantity: ";  
-        while (true) {
-            getline(cin, quantityInput); // Read as string
+// Sum of quantity * price over the rows selected in a bitmap (stock value in centavos)
+Money sumValueScalar(const int32_t *quantity, const Money *price, const uint64_t *bits, int n) {
+    Money total = 0;
+    for (int w = 0; w * 64 < n; w++) {
+        for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+            int row = w * 64 + __builtin_ctzll(word);
+            total += (Money)quantity[row] * price[row];
+        }
+    }
+    return total;
+}
 
-            if (!isValidInteger(quantityInput)) {  // Invalid input
-                cout << "Invalid input! Please enter a valid integer for quantity: ";
-            } else {
-                quantity = stoi(quantityInput); // Convert to integer
-                if (quantity > 0) {
-                    break; // Valid input, exit loop
-                } else {
-                cout << "Quantity must be greater than 0! Please enter again: ";
-                }
-            }
+#ifdef INVENTORY_HAVE_AVX2
+__attribute__((target("avx2")))
+void filterLessEqualAvx2(const int32_t *values, int n, int32_t limit, uint64_t *bits) {
+    __m256i lim = _mm256_set1_epi32(limit);
+    int full = n / 64;
+    for (int w = 0; w < full; w++) {
+        uint64_t word = 0;
+        for (int g = 0; g < 8; g++) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(values + w * 64 + g * 8));
+            __m256i over = _mm256_cmpgt_epi32(v, lim);
+            uint64_t mask = (uint64_t)(~_mm256_movemask_ps(_mm256_castsi256_ps(over)) & 0xFF);
+            word |= mask << (g * 8);
         }
+        bits[w] = word;
+    }
+    if (full * 64 < n) filterLessEqualScalar(values + full * 64, n - full * 64, limit, bits + full);
+}
 
-        // Validate Item Price input (float)
-        cout << "Enter Item Price: ";
-        while (true) {
-            getline(cin, priceInput); // Read as string
+__attribute__((target("avx2")))
+void filterRangeAvx2(const Money *values, int n, Money low, Money high, uint64_t *bits) {
+    __m256i lo = _mm256_set1_epi64x(low), hi = _mm256_set1_epi64x(high);
+    int full = n / 64;
+    for (int w = 0; w < full; w++) {
+        uint64_t word = 0;
+        for (int g = 0; g < 16; g++) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(values + w * 64 + g * 4));
+            __m256i out = _mm256_or_si256(_mm256_cmpgt_epi64(lo, v), _mm256_cmpgt_epi64(v, hi));
+            uint64_t mask = (uint64_t)(~_mm256_movemask_pd(_mm256_castsi256_pd(out)) & 0xF);
+            word |= mask << (g * 4);
+        }
+        bits[w] = word;
+    }
+    if (full * 64 < n) filterRangeScalar(values + full * 64, n - full * 64, low, high, bits + full);
+}
 
-            if (!isValidFloat(priceInput)) { // Invalid input
-                cout << "Invalid input! Please enter a valid price: ";
-            } else {
-                price = stof(priceInput); // Convert to float
-                if (price > 0) {
-                    break; // Valid input, exit loop
-                } else {
-                    cout << "Price must be greater than 0! Please enter again: ";
-                }
-            }
+__attribute__((target("avx2")))
+void filterEqualAvx2(const uint16_t *values, int n, uint16_t code, uint64_t *bits) {
+    __m256i target = _mm256_set1_epi16((short)code);
+    int full = n / 64;
+    for (int w = 0; w < full; w++) {
+        uint64_t word = 0;
+        for (int g = 0; g < 2; g++) {
+            const uint16_t *base = values + w * 64 + g * 32;
+            __m256i a = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)base), target);
+            __m256i b = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(base + 16)), target);
+            // Pack the 16-bit lane masks to bytes and undo the per-128-bit-lane interleave
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0xD8);
+            word |= (uint64_t)(uint32_t)_mm256_movemask_epi8(packed) << (g * 32);
         }
-    
-        items[itemCount++].setItem(id, name, quantity, price, category);
-        cout << "\nItem added successfully!\n";
+        bits[w] = word;
     }
+    if (full * 64 < n) filterEqualScalar(values + full * 64, n - full * 64, code, bits + full);
+}
 
-    void updateItem() {
-        cout << "\n=================== Update Item ====================\n";
+// Quantities are never negative, so each 64-bit product can be built from two
+// unsigned 32x32 multiplies: q * price = q * low + (q * high << 32)
+__attribute__((target("avx2")))
+Money sumValueAvx2(const int32_t *quantity, const Money *price, const uint64_t *bits, int n) {
+    const __m256i laneBits = _mm256_set_epi64x(8, 4, 2, 1);
+    __m256i total = _mm256_setzero_si256();
+    int full = n / 64;
+    for (int w = 0; w < full; w++) {
+        uint64_t word = bits[w];
+        if (word == 0) continue;
+        for (int g = 0; g < 16; g++) {
+            __m256i select = _mm256_set1_epi64x((long long)((word >> (g * 4)) & 0xF));
+            __m256i mask = _mm256_cmpeq_epi64(_mm256_and_si256(select, laneBits), laneBits);
+            __m256i q = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(quantity + w * 64 + g * 4)));
+            __m256i p = _mm256_loadu_si256((const __m256i *)(price + w * 64 + g * 4));
+            __m256i product = _mm256_add_epi64(_mm256_mul_epu32(q, p),
+                                               _mm256_slli_epi64(_mm256_mul_epu32(q, _mm256_srli_epi64(p, 32)), 32));
+            total = _mm256_add_epi64(total, _mm256_and_si256(product, mask));
+        }
+    }
+    alignas(32) Money lanes[4];
+    _mm256_store_si256((__m256i *)lanes, total);
+    Money sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    if (full * 64 < n) sum += sumValueScalar(quantity + full * 64, price + full * 64, bits + full, n - full * 64);
+    return sum;
+}
 
-        string id;
-        cout << "Enter Item ID to Update: ";
-        cin >> id;
-        id = toLowerCase(id); // Convert user input to lowercase
+bool cpuHasAvx2() {
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    return hasAvx2;
+}
+#endif
 
-        for (int i = 0; i < itemCount; i++) {
-            if (toLowerCase(items[i].getId()) == id) { // Compare in lowercase
-                int choice;
-                cout << "\nUpdate Information\n1 - Price\n2 - Quantity\n";
-                cout << "\nEnter your choice: ";
-                cin >> choice;
-
-                if (choice == 1) {
-                    string newPriceInput;
-                    float newPrice;
-
-                    cout << "Enter new Price: ";
-                    clearInput();
-                    while (true) {
-                    getline(cin, newPriceInput);
-
-                        if (isValidFloat(newPriceInput)) {
-                            newPrice = stof(newPriceInput); // Convert to float
-                            if (newPrice > 0) break; // Ensure the price is positive
-                            cout << "Price must be greater than 0! Please enter again: ";
-                        } else {
-                        cout << "Invalid input! Please enter a valid price: ";
-                        }
-                    }
+void filterLessEqual(const int32_t *values, int n, int32_t limit, uint64_t *bits) {
+#ifdef INVENTORY_HAVE_AVX2
+    if (cpuHasAvx2()) return filterLessEqualAvx2(values, n, limit, bits);
+#endif
+    filterLessEqualScalar(values, n, limit, bits);
+}
 
-                    float oldPrice = items[i].getPrice();
-                    items[i].updatePrice(newPrice);
-
-                    cout << "\nPrice of " << items[i].getName() << " is updated from " 
-                        << fixed << setprecision(2) << oldPrice << " Php to " 
-                        << fixed << setprecision(2) << newPrice << " Php.\n";
-                
-                } else if (choice == 2) {
-                    string newQuantityInput;
-                    int newQuantity;
-
-                    cout << "Enter new Quantity: ";
-                    while (true) {
-                    getline(cin, newQuantityInput);
-
-                        if (isValidInteger(newQuantityInput)) {
-                            newQuantity = stoi(newQuantityInput); // Convert to integer
-                            if (newQuantity > 0) break; // Ensure quantity is positive
-                            cout << "Quantity must be greater than 0! Please enter again: ";
-                        } else {
-                            cout << "Invalid input! Please enter a valid quantity: ";
-                        }
-                    }
+void filterRange(const Money *values, int n, Money low, Money high, uint64_t *bits) {
+#ifdef INVENTORY_HAVE_AVX2
+    if (cpuHasAvx2()) return filterRangeAvx2(values, n, low, high, bits);
+#endif
+    filterRangeScalar(values, n, low, high, bits);
+}
 
-            int oldQuantity = items[i].getQuantity();
-            items[i].updateQuantity(newQuantity);
+void filterEqual(const uint16_t *values, int n, uint16_t code, uint64_t *bits) {
+#ifdef INVENTORY_HAVE_AVX2
+    if (cpuHasAvx2()) return filterEqualAvx2(values, n, code, bits);
+#endif
+    filterEqualScalar(values, n, code, bits);
+}
 
-            cout << "\nQuantity of " << items[i].getName() << " is updated from " 
-                    << oldQuantity << " to " << newQuantity << ".\n";
-            }
+Money sumValue(const int32_t *quantity, const Money *price, const uint64_t *bits, int n) {
+#ifdef INVENTORY_HAVE_AVX2
+    if (cpuHasAvx2()) return sumValueAvx2(quantity, price, bits, n);
+#endif
+    return sumValueScalar(quantity, price, bits, n);
+}
 
-            // Prompt user to go back to the menu
-            cout << "\nPress Enter to go back to the Menu...";
-            clearInput();
-            cin.get(); // Wait for Enter
-            return;
+// Turn a selection bitmap into the list of selected rows, in order
+vector<int> bitmapToHandles(const vector<uint64_t> &bits) {
+    vector<int> handles;
+    for (int w = 0; w < (int)bits.size(); w++) {
+        for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+            handles.push_back(w * 64 + __builtin_ctzll(word));
         }
     }
-        // If item not found
-        cout << "\nItem ID not found!\n";
-        cout << "\nPress Enter to go back to the Menu...";
-        clearInput();
-        cin.get(); // Wait for Enter
-    }
+    return handles;
+}
 
-    void removeItem() {
-        cout << "\n==================== Remove Item ====================\n";
+// Items whose quantity drops to this level or below are low on stock, unless
+// their category or the item itself sets another reorder threshold
+const int DEFAULT_REORDER_THRESHOLD = 5;
 
-        string id;
-        cout << "\nEnter Item ID to Remove: ";
-        cin >> id;
-        id = toLowerCase(id); // Convert user input to lowercase
+// Running totals for the items in one category
+struct CategoryTotals {
+    long long items = 0;
+    long long quantity = 0;
+    Money value = 0; // Sum of quantity * price, in centavos
+};
 
-        for (int i = 0; i < itemCount; i++) {
-            if (toLowerCase(items[i].getId()) == id) { // Compare in lowercase
-                cout << "\nItem " << items[i].getName() << " has been removed from the inventory.\n";
-                for (int j = i; j < itemCount - 1; j++) {
-                    items[j] = items[j + 1];
-                }
-                itemCount--;
+// Categories registered at runtime, interned to small integer codes. Each
+// category also keeps the handles of its member items (in no particular order),
+// so listing a category costs O(k) in its size instead of a full scan, along
+// with its reorder threshold and running totals.
+class CategoryDictionary {
+private:
+    vector<string> names;                  // Category code -> display name
+    unordered_map<string, uint16_t> codes; // Lowercase name -> category code
+    vector<vector<int>> members;           // Category code -> member item handles
+    vector<int> thresholds;                // Category code -> reorder threshold
+    vector<CategoryTotals> totals;         // Category code -> running totals
 
-                cout << "\nPress Enter to go back to the Menu...";
-                clearInput();
-                cin.get(); // Wait for user to press Enter
-                return;
-            }
-        }
-    
-        // If item not found
-        cout << "\nItem ID not found!\n";
-        cout << "\nPress Enter to go back to the Menu...";
-        clearInput();
-        cin.get(); // Wait for user to press Enter
-    }   
+public:
+    static constexpr int MAX_CATEGORIES = UINT16_MAX + 1; // Codes are stored as uint16_t
 
-    void displayItemsByCategory() {
-        cout << "\n============= Display Items by Category =============\n";
-    
-        string categoryInput;
-        int categoryChoice;
+    int size() const { return (int)names.size(); }
+    const string &name(int code) const { return names[code]; }
+    const vector<int> &getMembers(int code) const { return members[code]; }
+    int threshold(int code) const { return thresholds[code]; }
+    void setThreshold(int code, int threshold) { thresholds[code] = threshold; }
+    const CategoryTotals &getTotals(int code) const { return totals[code]; }
+    CategoryTotals &getTotals(int code) { return totals[code]; }
 
-        // Loop until valid input is received
-        while (true) {
-            categoryChoice = getCategoryChoice();
+    // Code of a category (case-insensitive), or -1 if it was never registered
+    int find(const string &category) const {
+        auto it = codes.find(toLowerCase(category));
+        return it == codes.end() ? -1 : it->second;
+    }
 
-            if (categoryChoice == 4) {
-            return; // Return to main menu
-        }
+    // False if the category is new and MAX_CATEGORIES are already registered
+    bool canRegister(const string &category) const {
+        return size() < MAX_CATEGORIES || find(category) != -1;
+    }
 
-        // Convert category choice to string to validate
-        categoryInput = to_string(categoryChoice);
-        if (isValidInteger(categoryInput) && categoryChoice >= 1 && categoryChoice <= 3) {
-            break; // Valid input, exit loop
-        } else {
-            cout << "\nInvalid choice! Please enter a valid number between 1 and 3.\n";
-        }
+    // Register a category and return its code; registering a name again returns
+    // the existing code. Returns -1 if there is no room for another category.
+    int registerCategory(const string &category) {
+        int code = find(category);
+        if (code != -1) return code;
+        if (size() >= MAX_CATEGORIES) return -1;
+        code = (int)names.size();
+        names.push_back(category);
+        codes[toLowerCase(category)] = (uint16_t)code;
+        members.emplace_back();
+        thresholds.push_back(DEFAULT_REORDER_THRESHOLD);
+        totals.emplace_back();
+        return code;
     }
 
-        string category;
-        switch (categoryChoice) {
-            case 1:
-                category = "Clothing";
-                break;
-            case 2:
-                category = "Electronics";
-                break;
-            case 3:
-                category = "Entertainment";
-                break;
-            default:
-                cout << "\nCategory " << categoryChoice << " does not exist! Please try again.\n";
-                cout << "\nPress Enter to go back to the Menu...";
-                clearInput();
-                cin.get();
-                return;
-            }
+    // Add an item handle to a category; returns its position in the member list
+    int addMember(int code, int handle) {
+        members[code].push_back(handle);
+        return (int)members[code].size() - 1;
+    }
 
-        cout << "\nDisplaying Items in Category: " << category << endl;
-        printItemHeader();  // Call the header function here
+    // Remove the member at a position by moving the last member into its place.
+    // Returns the handle of the member that moved there, or -1 if none moved.
+    int removeMember(int code, int position) {
+        vector<int> &list = members[code];
+        int last = (int)list.size() - 1;
+        list[position] = list[last];
+        list.pop_back();
+        return position < last ? list[position] : -1;
+    }
 
-        bool itemFound = false;
-        for (int i = 0; i < itemCount; i++) {
-            if (items[i].getCategory() == category) {
-                cout << left << setw(20) << items[i].getId()
-                    << setw(20) << items[i].getName()
-                    << setw(20) << items[i].getQuantity()
-                    << setw(20) << fixed << setprecision(2) << items[i].getPrice()
-                    << setw(20) << items[i].getCategory() << endl;
-                itemFound = true;
-            }
-        }
+    // Point the member at a position to a new handle after the item moved
+    void moveMember(int code, int position, int handle) {
+        members[code][position] = handle;
+    }
 
-        if (!itemFound) {
-            cout << "\nNo items found in this category.\n";
-        }
+    void reserveMembers(int code, int count) {
+        members[code].reserve(count);
+    }
 
-        cout << "\nPress Enter to go back to the Menu...";
-        clearInput();
-        cin.get(); // Wait for Enter
+    // Empty every member list and reset the totals, keeping the registered categories
+    void clearMembers() {
+        for (vector<int> &list : members) list.clear();
+        for (CategoryTotals &categoryTotals : totals) categoryTotals = CategoryTotals();
     }
+};
 
-    void displayAllItems() {
-        cout << "\n================= Display All Items =================\n";
-        printItemHeader();  // Call the header function here
+// Inverted index from the three-character substrings (trigrams) of a text field
+// to the handles of the items containing them, for case-insensitive substring
+// search. Removals are lazy: a removed item's postings stay behind until the
+// index is remapped or rebuilt, and callers check every candidate against the
+// item's text, so stale postings are never returned.
+class TrigramIndex {
+private:
+    unordered_map<uint32_t, vector<int>> postings;
+    size_t entryCount = 0; // Postings stored, stale ones included
+    size_t staleCount = 0; // Postings left behind by removed items
+    vector<uint32_t> scratch;
 
-        for (int i = 0; i < itemCount; i++) {
-            cout << left << setw(20) << items[i].getId() 
-                 << setw(20) << items[i].getName() 
-                 << setw(20) << items[i].getQuantity() 
-                 << setw(20) << fixed << setprecision(2) << items[i].getPrice() 
-                 << setw(20) << items[i].getCategory() << endl;
+    // Distinct lowercase trigrams of a text
+    static void trigramsOf(string_view text, vector<uint32_t> &trigrams) {
+        trigrams.clear();
+        for (size_t i = 0; i + 3 <= text.size(); i++) {
+            trigrams.push_back((uint32_t)tolower((unsigned char)text[i]) << 16
+                               | (uint32_t)tolower((unsigned char)text[i + 1]) << 8
+                               | (uint32_t)tolower((unsigned char)text[i + 2]));
         }
-
-        cout << "\nPress Enter to go back to the Menu...";
-        clearInput();
-        cin.get();  // Wait for Enter
+        sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
     }
 
-    void searchItem() {
-        cout << "\n==================== Search Item ====================\n";
-    
-        string id;
-        cout << "Enter Item ID: ";
-        cin >> id;
-        id = toLowerCase(id); // Convert input to lowercase for case-insensitive search
+public:
+    void add(int handle, string_view text) {
+        trigramsOf(text, scratch);
+        for (uint32_t trigram : scratch) postings[trigram].push_back(handle);
+        entryCount += scratch.size();
+    }
 
-        bool found = false;
+    // Note that the item holding this text went away or moved
+    void forget(string_view text) {
+        trigramsOf(text, scratch);
+        staleCount += scratch.size();
+    }
 
-        printItemHeader();  // Call the header function here
+    // True once stale postings make up most of the index, so a rebuild pays off
+    bool isMostlyStale() const {
+        return staleCount > 4096 && staleCount * 2 > entryCount;
+    }
 
-        for (int i = 0; i < itemCount; i++) {
-            if (toLowerCase(items[i].getId()) == id) { // Compare in lowercase
-                cout << left << setw(20) << items[i].getId() 
-                     << setw(20) << items[i].getName() 
-                     << setw(20) << items[i].getQuantity() 
-                     << setw(20) << fixed << setprecision(2) << items[i].getPrice() 
-                     << setw(20) << items[i].getCategory() << endl;
-                found = true;
-                break;  // Exit loop as item is found
+    // Renumber handles after compaction; postings of removed items (-1) are dropped
+    void remap(const vector<int> &newHandles) {
+        entryCount = 0;
+        for (auto &entry : postings) {
+            vector<int> &list = entry.second;
+            size_t kept = 0;
+            for (int handle : list) {
+                if (handle < (int)newHandles.size() && newHandles[handle] != -1) list[kept++] = newHandles[handle];
             }
+            list.resize(kept);
+            entryCount += kept;
         }
+        staleCount = 0;
+    }
 
-        if (!found) {
-            cout << "\nItem ID not found!\n";
+    void clear() {
+        postings.clear();
+        entryCount = staleCount = 0;
+    }
+
+    // Handles that may contain a pattern of at least three characters: the
+    // shortest posting list among the pattern's trigrams. May hold stale or
+    // repeated handles.
+    const vector<int> &candidates(string_view pattern) {
+        static const vector<int> none;
+        trigramsOf(pattern, scratch);
+        const vector<int> *best = nullptr;
+        for (uint32_t trigram : scratch) {
+            auto it = postings.find(trigram);
+            if (it == postings.end()) return none;
+            if (!best || it->second.size() < best->size()) best = &it->second;
         }
+        return best ? *best : none;
+    }
+};
 
-        cout << "\nPress Enter to go back to the Menu...";
-        clearInput();
-        cin.get();  // Wait for Enter
+// Columnar copy of the numeric item fields, one row per item handle. Filters
+// scan these contiguous arrays without touching the item records and their
+// strings. Categories are stored as small dictionary codes.
+class ItemColumns {
+public:
+    vector<int32_t> quantity;
+    vector<Money> price;
+    vector<uint16_t> categoryCode;
+    vector<int32_t> categoryPosition; // Position of the row in its category's member list
+    vector<int32_t> reorderThreshold; // Item's own reorder threshold, or -1 to use its category's
+    vector<int32_t> lowStockPosition; // Position of the row in the low-stock watchlist, or -1
+    vector<uint64_t> liveBits;        // Bitmap of rows holding a live item
+
+    int size() const { return (int)quantity.size(); }
+
+    void setLive(int row, bool live) {
+        if (live) liveBits[row / 64] |= 1ull << (row % 64);
+        else liveBits[row / 64] &= ~(1ull << (row % 64));
     }
 
-    void sortItems() {
-        string sortChoiceInput, orderChoiceInput;
-        int sortChoice, orderChoice;
+    void push_back(int32_t itemQuantity, Money itemPrice, uint16_t itemCategory, int32_t itemCategoryPosition) {
+        int row = size();
+        quantity.push_back(itemQuantity);
+        price.push_back(itemPrice);
+        categoryCode.push_back(itemCategory);
+        categoryPosition.push_back(itemCategoryPosition);
+        reorderThreshold.push_back(-1);
+        lowStockPosition.push_back(-1);
+        if (row % 64 == 0) liveBits.push_back(0);
+        setLive(row, true);
+    }
 
-        // Sort Menu
-        while (true) {
-            cout << "\n==================== Sort Items ====================\n";
-            cout << "\nSort by:\n1 - Quantity\n2 - Price\n3 - Return to Main Menu\n";
-            cout << "\nEnter your choice: ";
-            getline(cin, sortChoiceInput);  // Use getline to read input
+    // Make room for the given number of rows. Capacity at least doubles when it
+    // grows, so reserving batch by batch stays amortized O(1) per row.
+    void reserve(int rows) {
+        if (rows <= (int)quantity.capacity()) return;
+        size_t target = max((size_t)rows, quantity.capacity() * 2);
+        quantity.reserve(target);
+        price.reserve(target);
+        categoryCode.reserve(target);
+        categoryPosition.reserve(target);
+        reorderThreshold.reserve(target);
+        lowStockPosition.reserve(target);
+        liveBits.reserve((target + 63) / 64);
+    }
 
-            if (!isValidInteger(sortChoiceInput)) {  // Invalid input
-                cout << "\nInvalid input! Please enter a valid integer for sort choice.\n";
-            } else {
-                sortChoice = stoi(sortChoiceInput); // Convert to integer
-                if (sortChoice >= 1 && sortChoice <= 3) {
-                    break; // Valid input, exit loop
+    // Shrink to the given number of rows
+    void resize(int rows) {
+        for (int row = rows; row < size(); row++) setLive(row, false);
+        quantity.resize(rows);
+        price.resize(rows);
+        categoryCode.resize(rows);
+        categoryPosition.resize(rows);
+        reorderThreshold.resize(rows);
+        lowStockPosition.resize(rows);
+        liveBits.resize((rows + 63) / 64);
+    }
+
+    void moveRow(int from, int to) {
+        quantity[to] = quantity[from];
+        price[to] = price[from];
+        categoryCode[to] = categoryCode[from];
+        categoryPosition[to] = categoryPosition[from];
+        reorderThreshold[to] = reorderThreshold[from];
+        lowStockPosition[to] = lowStockPosition[from];
+        setLive(to, true);
+        setLive(from, false);
+    }
+};
+
+// On-disk snapshot layout, in native byte order. Every section starts at an
+// 8-byte aligned offset recorded in the header, so a memory-mapped file can be
+// read in place:
+//   header | quantity int32[n] | price int64 centavos[n] | category code uint16[n]
+//   | ID refs[n] | name refs[n] | category name refs[c] | ID order int32[n]
+//   | item reorder thresholds int32[n] | category reorder thresholds int32[c]
+//   | detail refs[n] | string heap
+// Detail refs hold each item's details in text form (empty for general items).
+// The ID order section lists items sorted by case-insensitive ID, which lets
+// a mapped snapshot answer lookups by binary search without building an index.
+const char SNAPSHOT_MAGIC[8] = {'I', 'N', 'V', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t itemCount;
+    uint64_t categoryCount;
+    uint64_t quantityOffset;
+    uint64_t priceOffset;
+    uint64_t categoryOffset;
+    uint64_t idRefOffset;
+    uint64_t nameRefOffset;
+    uint64_t categoryNameOffset;
+    uint64_t idOrderOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t sequence; // LSN of the last logged mutation included
+    uint64_t itemThresholdOffset;
+    uint64_t categoryThresholdOffset;
+    uint64_t detailRefOffset;
+};
+
+// Location of a string in the snapshot's string heap
+struct SnapshotStringRef {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t reserved;
+};
+
+// Round a section size up to the next multiple of 8 bytes
+uint64_t alignSection(uint64_t size) {
+    return (size + 7) & ~(uint64_t)7;
+}
+
+// Write a file by writing a temporary file next to it, syncing it and renaming
+// it over the target, so readers never see a half-written file
+bool writeFileAtomically(const string &path, const char *data, size_t size) {
+    string tempPath = path + ".tmp";
+    int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = ::write(fd, data + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            ::unlink(tempPath.c_str());
+            return false;
+        }
+        written += (size_t)n;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || ::rename(tempPath.c_str(), path.c_str()) != 0) {
+        ::unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Read a whole file into memory; returns false if it cannot be opened
+bool readWholeFile(const string &path, string &contents) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    contents.clear();
+    char buffer[1 << 16];
+    ssize_t n;
+    while ((n = ::read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            return false;
+        }
+        contents.append(buffer, (size_t)n);
+    }
+    ::close(fd);
+    return true;
+}
+
+// Read-only view of a snapshot file mapped into memory. Items are read straight
+// from the mapping without copying or parsing them.
+class SnapshotView {
+private:
+    const char *data = nullptr;
+    size_t length = 0;
+    const SnapshotHeader *header = nullptr;
+    string lastError;
+
+    bool sectionFits(uint64_t offset, uint64_t count, uint64_t elementSize) const {
+        return offset % 8 == 0 && offset <= length && count <= (length - offset) / elementSize;
+    }
+
+    bool refFits(const SnapshotStringRef &ref) const {
+        return ref.offset <= header->stringsSize && ref.length <= header->stringsSize - ref.offset;
+    }
+
+    template <typename T>
+    const T *section(uint64_t offset) const { return reinterpret_cast<const T *>(data + offset); }
+
+    string_view text(const SnapshotStringRef &ref) const {
+        return string_view(data + header->stringsOffset + ref.offset, ref.length);
+    }
+
+    bool fail(const string &reason) {
+        lastError = reason;
+        close();
+        return false;
+    }
+
+public:
+    SnapshotView() {}
+    SnapshotView(const SnapshotView &) = delete;
+    SnapshotView &operator=(const SnapshotView &) = delete;
+    ~SnapshotView() { close(); }
+
+    // Map a snapshot file and check that its header and sections are consistent
+    bool open(const string &path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            lastError = "cannot open " + path;
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(SnapshotHeader)) {
+            ::close(fd);
+            lastError = path + " is not a snapshot file";
+            return false;
+        }
+        void *mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            lastError = "cannot map " + path;
+            return false;
+        }
+        data = (const char *)mapped;
+        length = (size_t)info.st_size;
+        header = section<SnapshotHeader>(0);
+
+        if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            return fail(path + " is not a snapshot file");
+        }
+        if (header->version != SNAPSHOT_VERSION || header->headerSize != sizeof(SnapshotHeader)) {
+            return fail(path + " has unsupported snapshot version " + to_string(header->version));
+        }
+        uint64_t n = header->itemCount, c = header->categoryCount;
+        if (n > (uint64_t)INT32_MAX || c > 65535
+            || !sectionFits(header->quantityOffset, n, sizeof(int32_t))
+            || !sectionFits(header->priceOffset, n, sizeof(Money))
+            || !sectionFits(header->categoryOffset, n, sizeof(uint16_t))
+            || !sectionFits(header->idRefOffset, n, sizeof(SnapshotStringRef))
+            || !sectionFits(header->nameRefOffset, n, sizeof(SnapshotStringRef))
+            || !sectionFits(header->categoryNameOffset, c, sizeof(SnapshotStringRef))
+            || !sectionFits(header->idOrderOffset, n, sizeof(int32_t))
+            || !sectionFits(header->itemThresholdOffset, n, sizeof(int32_t))
+            || !sectionFits(header->categoryThresholdOffset, c, sizeof(int32_t))
+            || !sectionFits(header->detailRefOffset, n, sizeof(SnapshotStringRef))
+            || !sectionFits(header->stringsOffset, header->stringsSize, 1)) {
+            return fail(path + " is truncated or corrupt");
+        }
+        for (uint64_t i = 0; i < n; i++) {
+            if (!refFits(section<SnapshotStringRef>(header->idRefOffset)[i])
+                || !refFits(section<SnapshotStringRef>(header->nameRefOffset)[i])
+                || section<uint16_t>(header->categoryOffset)[i] >= c
+                || (uint64_t)section<int32_t>(header->idOrderOffset)[i] >= n
+                || !refFits(section<SnapshotStringRef>(header->detailRefOffset)[i])) {
+                return fail(path + " is truncated or corrupt");
+            }
+            ItemDetails parsed;
+            if (!parseDetails(details(i), parsed)) return fail(path + " is truncated or corrupt");
+        }
+        for (uint64_t k = 0; k < c; k++) {
+            if (!refFits(section<SnapshotStringRef>(header->categoryNameOffset)[k])) {
+                return fail(path + " is truncated or corrupt");
+            }
+        }
+        return true;
+    }
+
+    void close() {
+        if (data) munmap((void *)data, length);
+        data = nullptr;
+        length = 0;
+        header = nullptr;
+    }
+
+    bool isOpen() const { return data != nullptr; }
+    const string &error() const { return lastError; }
+
+    int itemCount() const { return (int)header->itemCount; }
+    uint64_t sequence() const { return header->sequence; }
+    int categoryCount() const { return (int)header->categoryCount; }
+    int quantity(int i) const { return section<int32_t>(header->quantityOffset)[i]; }
+    Money price(int i) const { return section<Money>(header->priceOffset)[i]; }
+    int categoryCode(int i) const { return section<uint16_t>(header->categoryOffset)[i]; }
+    int itemThreshold(int i) const { return section<int32_t>(header->itemThresholdOffset)[i]; }
+    int categoryThreshold(int code) const { return section<int32_t>(header->categoryThresholdOffset)[code]; }
+    string_view id(int i) const { return text(section<SnapshotStringRef>(header->idRefOffset)[i]); }
+    string_view name(int i) const { return text(section<SnapshotStringRef>(header->nameRefOffset)[i]); }
+    // Item details in text form (see parseDetails); empty for general items
+    string_view details(int i) const { return text(section<SnapshotStringRef>(header->detailRefOffset)[i]); }
+    string_view categoryName(int code) const { return text(section<SnapshotStringRef>(header->categoryNameOffset)[code]); }
+
+    // Find an item by ID (case-insensitive) with a binary search; -1 if not found
+    int find(string_view itemId) const {
+        const int32_t *order = section<int32_t>(header->idOrderOffset);
+        int low = 0, high = itemCount();
+        while (low < high) {
+            int mid = low + (high - low) / 2;
+            int cmp = compareIgnoreCase(id(order[mid]), itemId);
+            if (cmp == 0) return order[mid];
+            if (cmp < 0) low = mid + 1;
+            else high = mid;
+        }
+        return -1;
+    }
+};
+
+// CRC-32 (IEEE) used to detect torn or corrupt log records
+uint32_t crc32(const char *data, size_t size) {
+    // Built once, thread-safely: server workers and the compactor both checksum records
+    static const array<uint32_t, 256> table = [] {
+        array<uint32_t, 256> entries;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+        return entries;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Little helpers for building and reading binary records
+void appendBytes(string &out, const void *value, size_t size) {
+    out.append((const char *)value, size);
+}
+
+void appendString(string &out, const string &text) {
+    uint32_t length = (uint32_t)text.size();
+    appendBytes(out, &length, sizeof(length));
+    out += text;
+}
+
+class ByteReader {
+private:
+    const char *data;
+    size_t size;
+    size_t position = 0;
+
+public:
+    ByteReader(const char *bytes, size_t length) : data(bytes), size(length) {}
+
+    bool atEnd() const { return position == size; }
+
+    template <typename T>
+    bool read(T &value) {
+        if (size - position < sizeof(T)) return false;
+        memcpy(&value, data + position, sizeof(T));
+        position += sizeof(T);
+        return true;
+    }
+
+    bool readString(string &text) {
+        uint32_t length;
+        if (!read(length) || size - position < length) return false;
+        text.assign(data + position, length);
+        position += length;
+        return true;
+    }
+};
+
+// Kinds of mutation recorded in the write-ahead log
+enum LogRecordType : uint8_t {
+    LOG_ADD = 1,                    // id, name, quantity, price in centavos, category name, details in text form
+    LOG_SET_PRICE = 2,              // id, price in centavos
+    LOG_SET_QUANTITY = 3,           // id, quantity
+    LOG_REMOVE = 4,                 // id
+    LOG_SET_ITEM_THRESHOLD = 5,     // id, reorder threshold (-1 = category's)
+    LOG_SET_CATEGORY_THRESHOLD = 6, // category name, reorder threshold
+    LOG_SET_QUANTITIES = 7          // count, then (id, quantity) per item; one stock transaction
+};
+
+// Append-only log of inventory mutations. Each record is framed as
+//   uint32 payload length | uint32 CRC-32 of payload | payload
+// and the payload starts with the record's sequence number (LSN) and type.
+// Replay stops at the first torn or corrupt record, which is where a crash
+// interrupted the last write.
+//
+// By default every record is written and fsynced before append() returns.
+// With group commit, records are buffered and fsynced together once a batch
+// fills up or a background flusher's delay expires, trading a bounded window
+// of recent changes for far fewer fsyncs.
+class WriteAheadLog {
+private:
+    string path;
+    int fd = -1;
+    uint64_t nextLsn = 1;
+    size_t fileBytes = 0;    // Bytes already written to the file
+    mutex lock;
+    string pending;          // Framed records not yet written
+    int pendingRecords = 0;
+    int groupSize = 1;       // Records per fsync; 1 disables group commit
+    int groupDelayMs = 0;
+    int batchDepth = 0;      // Open beginBatch() calls; flushing waits until they end
+    thread flusher;
+    condition_variable flusherWake;
+    bool stopping = false;
+    atomic<bool> failed{false}; // A write or fsync failed; nothing more is written
+
+    // Write and fsync everything pending; caller holds the lock. If that fails
+    // the file is cut back to its last whole record, so that records appended
+    // later can't end up behind a torn one, and the records stay pending.
+    // Returns false if anything appended so far is not durable.
+    bool flushLocked() {
+        if (failed || fd < 0) return pending.empty() && !failed;
+        if (pending.empty()) return true;
+        size_t written = 0;
+        while (written < pending.size()) {
+            ssize_t n = ::write(fd, pending.data() + written, pending.size() - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            written += (size_t)n;
+        }
+        if (written < pending.size() || ::fdatasync(fd) != 0) {
+            if (::ftruncate(fd, (off_t)fileBytes) != 0) {
+                // Nothing more to do: replay stops at the torn record, and nothing follows it
+            }
+            failed = true;
+            return false;
+        }
+        fileBytes += written;
+        pending.clear();
+        pendingRecords = 0;
+        return true;
+    }
+
+    void flusherLoop() {
+        unique_lock<mutex> guard(lock);
+        while (!stopping) {
+            flusherWake.wait_for(guard, chrono::milliseconds(groupDelayMs));
+            flushLocked();
+        }
+    }
+
+    void stopFlusher() {
+        if (flusher.joinable()) {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            flusherWake.notify_one();
+            flusher.join();
+            stopping = false;
+        }
+    }
+
+    // Walk the intact records at the start of a log's contents, calling
+    // fn(offset, frameSize, lsn, type, body) for each. Returns the length of
+    // the intact prefix.
+    static size_t scanRecords(const string &contents,
+                              const function<void(size_t, size_t, uint64_t, uint8_t, ByteReader &)> &fn) {
+        size_t offset = 0;
+        while (contents.size() - offset >= 8) {
+            uint32_t length, checksum;
+            memcpy(&length, contents.data() + offset, 4);
+            memcpy(&checksum, contents.data() + offset + 4, 4);
+            if (length < 9 || contents.size() - offset - 8 < length) break;
+            const char *payload = contents.data() + offset + 8;
+            if (crc32(payload, length) != checksum) break;
+
+            uint64_t lsn;
+            uint8_t type;
+            memcpy(&lsn, payload, sizeof(lsn));
+            memcpy(&type, payload + sizeof(lsn), sizeof(type));
+            ByteReader body(payload + 9, length - 9);
+            fn(offset, 8 + length, lsn, type, body);
+            offset += 8 + length;
+        }
+        return offset;
+    }
+
+public:
+    // Call fn(lsn, type, body) for every intact record in a log file, in order.
+    // Returns the byte length of the intact prefix of the file.
+    static size_t replay(const string &logPath, const function<void(uint64_t, uint8_t, ByteReader &)> &fn) {
+        string contents;
+        if (!readWholeFile(logPath, contents)) return 0;
+        return scanRecords(contents, [&](size_t, size_t, uint64_t lsn, uint8_t type, ByteReader &body) {
+            fn(lsn, type, body);
+        });
+    }
+
+    WriteAheadLog() {}
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+    ~WriteAheadLog() { close(); }
+
+    // Open a log for appending. validLength cuts off a torn tail found by
+    // replay(); firstLsn is the sequence number the next record will get.
+    bool open(const string &logPath, size_t validLength, uint64_t firstLsn) {
+        close();
+        path = logPath;
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) return false;
+        if (::ftruncate(fd, (off_t)validLength) != 0) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        nextLsn = firstLsn;
+        fileBytes = validLength;
+        pending.clear(); // Left over if the previous file failed
+        pendingRecords = 0;
+        failed = false;
+        return true;
+    }
+
+    void close() {
+        stopFlusher();
+        lock_guard<mutex> guard(lock);
+        flushLocked();
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    bool isOpen() const { return fd >= 0; }
+    bool hasFailed() const { return failed; }
+    uint64_t lastLsn() const { return nextLsn - 1; }
+
+    // Batch up to records fsyncs per group, flushing at least every delayMs
+    // milliseconds. A size of 1 makes every append durable on return.
+    void setGroupCommit(int records, int delayMs) {
+        stopFlusher();
+        lock_guard<mutex> guard(lock);
+        flushLocked();
+        groupSize = max(1, records);
+        groupDelayMs = max(1, delayMs);
+        if (groupSize > 1) flusher = thread([this] { flusherLoop(); });
+    }
+
+    // Append one record; body is the type-specific part of the payload.
+    // Returns the record's LSN, or 0 if the log has failed or the record could
+    // not be made durable (without group commit).
+    uint64_t append(uint8_t type, const string &body) {
+        lock_guard<mutex> guard(lock);
+        if (failed) return 0;
+        uint64_t lsn = nextLsn++;
+        string payload;
+        payload.reserve(9 + body.size());
+        appendBytes(payload, &lsn, sizeof(lsn));
+        appendBytes(payload, &type, sizeof(type));
+        payload += body;
+
+        uint32_t length = (uint32_t)payload.size(), checksum = crc32(payload.data(), payload.size());
+        appendBytes(pending, &length, sizeof(length));
+        appendBytes(pending, &checksum, sizeof(checksum));
+        pending += payload;
+        if (++pendingRecords >= groupSize && batchDepth == 0 && !flushLocked()) return 0;
+        return lsn;
+    }
+
+    // Hold back per-record fsyncs until the matching endBatch(), so a batch of
+    // appends shares one fsync
+    void beginBatch() {
+        lock_guard<mutex> guard(lock);
+        batchDepth++;
+    }
+
+    void endBatch() {
+        lock_guard<mutex> guard(lock);
+        if (--batchDepth == 0 && pendingRecords >= groupSize) flushLocked();
+    }
+
+    // Make every appended record durable now; false if that failed
+    bool commit() {
+        lock_guard<mutex> guard(lock);
+        return flushLocked();
+    }
+
+    // Size of the log in bytes, including records not yet flushed
+    size_t size() {
+        lock_guard<mutex> guard(lock);
+        return fileBytes + pending.size();
+    }
+
+    // Drop every record with LSN <= upToLsn, which a snapshot now covers. The
+    // remaining tail is copied to a new file that atomically replaces the log.
+    // Returns false if the log was left as it was, or if the new file could not
+    // be opened; then the log has failed, as appends to the old, replaced file
+    // would be lost.
+    bool truncateBefore(uint64_t upToLsn) {
+        lock_guard<mutex> guard(lock);
+        if (!flushLocked()) return false;
+        string contents, tail;
+        if (!readWholeFile(path, contents)) return false;
+        scanRecords(contents, [&](size_t offset, size_t frameSize, uint64_t lsn, uint8_t, ByteReader &) {
+            if (lsn > upToLsn) tail.append(contents, offset, frameSize);
+        });
+        if (!writeFileAtomically(path, tail.data(), tail.size())) return false;
+        int reopened = ::open(path.c_str(), O_WRONLY | O_APPEND);
+        if (reopened < 0) {
+            failed = true;
+            return false;
+        }
+        ::close(fd);
+        fd = reopened;
+        fileBytes = tail.size();
+        return true;
+    }
+};
+
+// Reads delimited text (CSV or TSV) from a file in large chunks and splits it
+// into rows of fields without copying them. CSV fields may be double-quoted,
+// with "" standing for a quote and commas or line breaks allowed inside.
+// Fields returned by nextRow() stay valid until the next call.
+class DelimitedReader {
+private:
+    static const size_t CHUNK_SIZE = 1 << 20;
+    int fd = -1;
+    char delimiter;
+    bool quoting;
+    string buffer;
+    size_t position = 0;
+    bool endOfFile = false;
+    long long linesRead = 0;
+    long long rowLine = 0;
+    vector<string> unquoted;     // Unescaped copies of quoted fields that had "" escapes
+    vector<size_t> escapedFields; // Which fields those copies belong to
+
+    // Read another chunk, keeping the unread part of the buffer
+    bool refill() {
+        if (endOfFile) return false;
+        buffer.erase(0, position);
+        position = 0;
+        size_t used = buffer.size();
+        buffer.resize(used + CHUNK_SIZE);
+        ssize_t n;
+        do {
+            n = ::read(fd, &buffer[used], CHUNK_SIZE);
+        } while (n < 0 && errno == EINTR);
+        buffer.resize(used + (n > 0 ? (size_t)n : 0));
+        if (n <= 0) endOfFile = true;
+        return n > 0;
+    }
+
+    // Find the end of the row starting at position, honouring quotes.
+    // Returns string::npos if the buffer ends before the row does.
+    size_t findRowEnd() const {
+        bool inQuotes = false;
+        for (size_t i = position; i < buffer.size(); i++) {
+            char c = buffer[i];
+            if (quoting && c == '"') inQuotes = !inQuotes;
+            else if (c == '\n' && !inQuotes) return i;
+        }
+        return string::npos;
+    }
+
+public:
+    DelimitedReader(char fieldDelimiter) : delimiter(fieldDelimiter), quoting(fieldDelimiter == ',') {}
+    DelimitedReader(const DelimitedReader &) = delete;
+    DelimitedReader &operator=(const DelimitedReader &) = delete;
+    ~DelimitedReader() { close(); }
+
+    bool open(const string &path) {
+        close();
+        fd = ::open(path.c_str(), O_RDONLY);
+        buffer.clear();
+        position = 0;
+        endOfFile = false;
+        linesRead = 0;
+        rowLine = 0;
+        return fd >= 0;
+    }
+
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    // Line number where the last row returned by nextRow() started
+    long long getLineNumber() const { return rowLine; }
+
+    // Split the next non-empty row into fields; returns false at end of input
+    bool nextRow(vector<string_view> &fields) {
+        while (true) {
+            size_t end = findRowEnd();
+            while (end == string::npos && refill()) end = findRowEnd();
+            if (end == string::npos) {
+                if (position >= buffer.size()) return false;
+                end = buffer.size(); // Last row without a trailing newline
+            }
+
+            size_t rowStart = position;
+            size_t rowEnd = end;
+            position = end < buffer.size() ? end + 1 : end;
+            rowLine = linesRead + 1;
+            linesRead += 1 + count(buffer.begin() + rowStart, buffer.begin() + rowEnd, '\n');
+            if (rowEnd > rowStart && buffer[rowEnd - 1] == '\r') rowEnd--;
+            if (rowEnd == rowStart) continue; // Skip blank lines
+
+            fields.clear();
+            unquoted.clear();
+            escapedFields.clear();
+            size_t i = rowStart;
+            while (true) {
+                if (quoting && i < rowEnd && buffer[i] == '"') {
+                    // Quoted field: runs to the next quote not followed by another quote
+                    size_t start = ++i;
+                    bool escaped = false;
+                    while (i < rowEnd && !(buffer[i] == '"' && (i + 1 >= rowEnd || buffer[i + 1] != '"'))) {
+                        if (buffer[i] == '"') {
+                            escaped = true;
+                            i++;
+                        }
+                        i++;
+                    }
+                    string_view field(buffer.data() + start, min(i, rowEnd) - start);
+                    if (escaped) {
+                        string text;
+                        for (size_t k = 0; k < field.size(); k++) {
+                            text += field[k];
+                            if (field[k] == '"') k++;
+                        }
+                        unquoted.push_back(std::move(text));
+                        escapedFields.push_back(fields.size());
+                    }
+                    fields.push_back(field);
+                    if (i < rowEnd) i++; // Closing quote
+                    while (i < rowEnd && buffer[i] != delimiter) i++;
+                } else {
+                    size_t start = i;
+                    while (i < rowEnd && buffer[i] != delimiter) i++;
+                    fields.push_back(string_view(buffer.data() + start, i - start));
+                }
+                if (i >= rowEnd) break;
+                i++; // Delimiter
+            }
+            for (size_t u = 0; u < unquoted.size(); u++) {
+                fields[escapedFields[u]] = unquoted[u];
+            }
+            return true;
+        }
+    }
+};
+
+// A new item waiting to be added, e.g. one row of a bulk import
+struct ItemRecord {
+    string id, name;
+    int quantity;
+    Money price;
+    string category;
+    string details; // Text form (see parseDetails); empty for general items
+};
+
+// One line of a stock transaction: add delta units to an item (negative to take them away)
+struct StockChange {
+    string id;
+    int delta;
+};
+
+// Outcome of a bulk import
+struct ImportReport {
+    long long rowsRead = 0;
+    long long itemsAdded = 0;
+    long long rowsRejected = 0;
+    vector<string> errors; // "line N: reason" for the first rejected rows
+};
+
+// Function to strip leading and trailing spaces and tabs from a field
+string_view trimField(string_view field) {
+    while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) field.remove_prefix(1);
+    while (!field.empty() && (field.back() == ' ' || field.back() == '\t')) field.remove_suffix(1);
+    return field;
+}
+
+// Function to turn one imported row (id, name, quantity, price, category and
+// optionally details such as expires=2026-11-01) into an item, applying the
+// same rules as the Add Item prompt. Returns false with a reason if the row is
+// rejected.
+bool parseItemRecord(const vector<string_view> &fields, ItemRecord &record, string &reason) {
+    if (fields.size() != 5 && fields.size() != 6) {
+        reason = "expected 5 or 6 fields (id, name, quantity, price, category[, details]), found "
+                 + to_string(fields.size());
+        return false;
+    }
+    string_view id = trimField(fields[0]), name = trimField(fields[1]), quantity = trimField(fields[2]);
+    string_view price = trimField(fields[3]), category = trimField(fields[4]);
+
+    if (id.empty()) {
+        reason = "item ID is empty";
+        return false;
+    }
+    if (!isValidInteger(quantity)) {
+        reason = "quantity '" + string(quantity) + "' is not a valid integer";
+        return false;
+    }
+    auto parsedQuantity = from_chars(quantity.data(), quantity.data() + quantity.size(), record.quantity);
+    if (parsedQuantity.ec != errc()) {
+        reason = "quantity '" + string(quantity) + "' is too large";
+        return false;
+    }
+    if (record.quantity <= 0) {
+        reason = "quantity must be greater than 0";
+        return false;
+    }
+    if (!parseMoney(price, record.price)) {
+        reason = "price '" + string(price) + "' is not a valid price";
+        return false;
+    }
+    if (record.price <= 0) {
+        reason = "price must be greater than 0";
+        return false;
+    }
+    if (category.empty()) {
+        reason = "category is empty";
+        return false;
+    }
+    string_view details = fields.size() == 6 ? trimField(fields[5]) : string_view();
+    ItemDetails parsedDetails;
+    if (!parseDetails(details, parsedDetails)) {
+        reason = "details '" + string(details) + "' are not expires=YYYY-MM-DD, serial=<serial> or size=<size>";
+        return false;
+    }
+    record.id.assign(id);
+    record.name.assign(name);
+    record.category.assign(category);
+    record.details.assign(details);
+    return true;
+}
+
+// Output collected in a large buffer and written to a file descriptor in big
+// blocks, instead of going through cout with a flush on every endl
+class OutputBuffer {
+private:
+    static const size_t FLUSH_SIZE = 1 << 16;
+    int fd;
+    string buffer;
+
+public:
+    explicit OutputBuffer(int outputFd = STDOUT_FILENO) : fd(outputFd) {
+        buffer.reserve(FLUSH_SIZE * 2);
+    }
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+    ~OutputBuffer() { flush(); }
+
+    OutputBuffer &operator<<(string_view text) {
+        buffer.append(text.data(), text.size());
+        if (buffer.size() >= FLUSH_SIZE) flush();
+        return *this;
+    }
+
+    OutputBuffer &operator<<(char c) {
+        buffer += c;
+        return *this;
+    }
+
+    OutputBuffer &operator<<(long long value) {
+        char digits[24];
+        auto result = to_chars(digits, digits + sizeof(digits), value);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+
+    OutputBuffer &operator<<(int value) { return *this << (long long)value; }
+
+    // Everything collected so far; used when the output goes somewhere other than a file descriptor
+    string &contents() { return buffer; }
+
+    void flush() {
+        if (fd < 0) return; // Collecting only
+        if (fd == STDOUT_FILENO) cout.flush(); // Keep earlier cout output in front of ours
+        size_t written = 0;
+        while (written < buffer.size()) {
+            ssize_t n = ::write(fd, buffer.data() + written, buffer.size() - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            written += (size_t)n;
+        }
+        buffer.clear();
+    }
+};
+
+// Formats item rows for the item tables shown by the menu and batch commands.
+// Each row is built in one reusable line buffer (numbers through to_chars) and
+// handed to an OutputBuffer, so a long listing costs a few large writes.
+class TableRenderer {
+private:
+    static const size_t COLUMN_WIDTH = 20;
+    OutputBuffer &out;
+    string line;
+    size_t rowLimit = 0; // 0 = no limit
+    size_t rowsWritten = 0;
+    size_t rowsSkipped = 0;
+
+    void appendField(string_view text) {
+        line.append(text.data(), text.size());
+        if (text.size() < COLUMN_WIDTH) line.append(COLUMN_WIDTH - text.size(), ' ');
+    }
+
+    // Start a row with every field but the details; false if it is past the limit
+    bool beginRow(string_view id, string_view name, int quantity, Money price, string_view category) {
+        if (rowLimit != 0 && rowsWritten >= rowLimit) {
+            rowsSkipped++;
+            return false;
+        }
+        char number[32];
+        line.clear();
+        appendField(id);
+        appendField(name);
+        auto digits = to_chars(number, number + sizeof(number), quantity);
+        appendField(string_view(number, digits.ptr - number));
+        appendField(string_view(number, formatMoney(number, price) - number));
+        appendField(category);
+        return true;
+    }
+
+    void endRow() {
+        line += '\n';
+        out << line;
+        rowsWritten++;
+    }
+
+public:
+    explicit TableRenderer(OutputBuffer &output, size_t limit = 0) : out(output), rowLimit(limit) {
+        line.reserve(COLUMN_WIDTH * 8);
+    }
+
+    void header() {
+        out << "\n--------------------------------------------------------------------------------------------------------------------------------\n";
+        line.clear();
+        appendField("ID");
+        appendField("Name");
+        appendField("Quantity");
+        appendField("Price");
+        appendField("Category");
+        appendField("Details");
+        line += '\n';
+        out << line;
+        out << "--------------------------------------------------------------------------------------------------------------------------------\n";
+    }
+
+    // Write one item; rows past the limit are only counted
+    void row(const Item &item, const ItemDetails &details = ItemDetails()) {
+        if (!beginRow(item.getId(), item.getName(), item.getQuantity(), item.getPrice(), item.getCategory())) return;
+        appendDetails(line, details);
+        endRow();
+    }
+
+    // Same for an item kept outside the inventory, with its details already in text form
+    void row(string_view id, string_view name, int quantity, Money price, string_view category, string_view details) {
+        if (!beginRow(id, name, quantity, price, category)) return;
+        line.append(details.data(), details.size());
+        endRow();
+    }
+
+    // Note how many rows the limit left out, then start counting again
+    void finish() {
+        if (rowsSkipped > 0) {
+            out << "... " << (long long)rowsSkipped << " more rows not shown\n";
+        }
+        rowsWritten = rowsSkipped = 0;
+    }
+
+    void setRowLimit(size_t limit) { rowLimit = limit; }
+    size_t getRowLimit() const { return rowLimit; }
+};
+
+// Details of one kind of item, stored densely so that a loop over one kind
+// (e.g. every expiry date) touches nothing else
+template <typename Details>
+struct DetailPool {
+    vector<Details> values;
+    vector<int> owners; // Handle of the item each entry belongs to
+};
+
+// Growable item storage made of fixed-size chunks. Chunks are only allocated as
+// items are added, and existing items never move when the store grows, so a
+// position (handle) stays valid until the item is removed. Removed items leave a
+// tombstone behind until the store is compacted.
+//
+// The items' strings live in the store's own arena rather than in separate
+// heap allocations, and each category name is kept there once for all items.
+// Kind-specific details are kept in one pool per kind; each slot records its
+// kind and its position in that pool.
+class ItemStore {
+private:
+    static const int CHUNK_SIZE = 1024;
+    vector<unique_ptr<vector<GeneralItem>>> chunks;
+    vector<bool> alive; // false for tombstoned slots
+    vector<ItemKind> kinds;
+    vector<int> detailSlots; // Position in the kind's pool; -1 for general items
+    tuple<DetailPool<PerishableDetails>, DetailPool<ElectronicDetails>, DetailPool<ClothingDetails>> pools;
+    int count = 0;
+    int deadCount = 0;
+    StringArena strings;
+    vector<string_view> categoryNames; // Interned category names
+    size_t deadStringBytes = 0;        // Arena bytes of removed items
+
+    // Copy an item's strings into the arena
+    void storeStrings(GeneralItem &item) {
+        string_view id = item.getId(), lowerId = item.getLowerId();
+        item.setId(strings.store(id));
+        item.setLowerId(lowerId == id ? item.getId() : strings.store(lowerId));
+        item.setName(strings.store(item.getName()));
+        item.setCategory(internCategory(item.getCategory()));
+    }
+
+    void storeStrings(PerishableDetails &) {}
+    void storeStrings(ElectronicDetails &details) { details.serial = strings.store(details.serial); }
+    void storeStrings(ClothingDetails &details) { details.size = strings.store(details.size); }
+
+    size_t stringBytes(const GeneralItem &item) const {
+        size_t bytes = item.getId().size() + item.getName().size();
+        if (item.getLowerId().data() != item.getId().data()) bytes += item.getLowerId().size();
+        return bytes;
+    }
+
+    static size_t stringBytes(const PerishableDetails &) { return 0; }
+    static size_t stringBytes(const ElectronicDetails &details) { return details.serial.size(); }
+    static size_t stringBytes(const ClothingDetails &details) { return details.size.size(); }
+
+    string_view internCategory(string_view name) {
+        for (string_view known : categoryNames) {
+            if (known == name) return known;
+        }
+        categoryNames.push_back(strings.store(name));
+        return categoryNames.back();
+    }
+
+    template <typename Details>
+    void addDetails(int handle, Details details) {
+        DetailPool<Details> &pool = get<DetailPool<Details>>(pools);
+        storeStrings(details);
+        kinds[handle] = Details::KIND;
+        detailSlots[handle] = (int)pool.values.size();
+        pool.values.push_back(details);
+        pool.owners.push_back(handle);
+    }
+
+    // Take an item's entry out of its pool, moving the pool's last entry into the gap
+    template <typename Details>
+    void dropDetails(int handle) {
+        DetailPool<Details> &pool = get<DetailPool<Details>>(pools);
+        int slot = detailSlots[handle];
+        deadStringBytes += stringBytes(pool.values[slot]);
+        if (slot != (int)pool.values.size() - 1) {
+            pool.values[slot] = pool.values.back();
+            pool.owners[slot] = pool.owners.back();
+            detailSlots[pool.owners[slot]] = slot;
+        }
+        pool.values.pop_back();
+        pool.owners.pop_back();
+    }
+
+    void dropDetails(int handle) {
+        switch (kinds[handle]) {
+            case KIND_PERISHABLE: dropDetails<PerishableDetails>(handle); break;
+            case KIND_ELECTRONIC: dropDetails<ElectronicDetails>(handle); break;
+            case KIND_CLOTHING: dropDetails<ClothingDetails>(handle); break;
+            default: break;
+        }
+        kinds[handle] = KIND_GENERAL;
+        detailSlots[handle] = -1;
+    }
+
+    // Move a slot's kind and pool position to another slot
+    void moveDetails(int from, int to) {
+        kinds[to] = kinds[from];
+        detailSlots[to] = detailSlots[from];
+        switch (kinds[to]) {
+            case KIND_PERISHABLE: get<DetailPool<PerishableDetails>>(pools).owners[detailSlots[to]] = to; break;
+            case KIND_ELECTRONIC: get<DetailPool<ElectronicDetails>>(pools).owners[detailSlots[to]] = to; break;
+            case KIND_CLOTHING: get<DetailPool<ClothingDetails>>(pools).owners[detailSlots[to]] = to; break;
+            default: break;
+        }
+        kinds[from] = KIND_GENERAL;
+        detailSlots[from] = -1;
+    }
+
+    // Drop tombstones at the end of the store, they don't need compaction
+    void trimDeadTail() {
+        while (count > 0 && !alive[count - 1]) {
+            pop_back();
+            deadCount--;
+        }
+    }
+
+public:
+    int size() const { return count; } // Number of slots, including tombstones
+    int liveCount() const { return count - deadCount; }
+    int tombstoneCount() const { return deadCount; }
+    bool isAlive(int handle) const { return alive[handle]; }
+
+    GeneralItem &operator[](int handle) { return (*chunks[handle / CHUNK_SIZE])[handle % CHUNK_SIZE]; }
+    const GeneralItem &operator[](int handle) const { return (*chunks[handle / CHUNK_SIZE])[handle % CHUNK_SIZE]; }
+
+    ItemKind kind(int handle) const { return kinds[handle]; }
+
+    // An item's details, read from its kind's pool
+    ItemDetails details(int handle) const {
+        int slot = detailSlots[handle];
+        switch (kinds[handle]) {
+            case KIND_PERISHABLE: return get<DetailPool<PerishableDetails>>(pools).values[slot];
+            case KIND_ELECTRONIC: return get<DetailPool<ElectronicDetails>>(pools).values[slot];
+            case KIND_CLOTHING: return get<DetailPool<ClothingDetails>>(pools).values[slot];
+            default: return monostate();
+        }
+    }
+
+    // Every item of one kind, for loops that only care about that kind
+    template <typename Details>
+    const DetailPool<Details> &pool() const { return get<DetailPool<Details>>(pools); }
+
+    // Allocate chunks up front for a bulk load of the given number of items
+    void reserve(int capacity) {
+        while ((int)chunks.size() * CHUNK_SIZE < capacity) {
+            chunks.push_back(make_unique<vector<GeneralItem>>());
+            chunks.back()->reserve(CHUNK_SIZE);
+        }
+    }
+
+    // Append an item and return its handle. The item's strings (including its
+    // lowercase ID, which the caller sets) and details are copied into the store.
+    int push_back(const GeneralItem &item, const ItemDetails &details = ItemDetails()) {
+        reserve(count + 1);
+        chunks[count / CHUNK_SIZE]->push_back(item);
+        storeStrings(chunks[count / CHUNK_SIZE]->back());
+        alive.push_back(true);
+        kinds.push_back(KIND_GENERAL);
+        detailSlots.push_back(-1);
+        visit([&](const auto &value) {
+            if constexpr (!is_same_v<decay_t<decltype(value)>, monostate>) addDetails(count, value);
+        }, details);
+        return count++;
+    }
+
+    void pop_back() {
+        count--;
+        chunks[count / CHUNK_SIZE]->pop_back();
+        alive.pop_back();
+        kinds.pop_back();
+        detailSlots.pop_back();
+        // Give back trailing chunks that are now empty
+        while (!chunks.empty() && chunks.back()->empty() && (int)(chunks.size() - 1) * CHUNK_SIZE >= count) {
+            chunks.pop_back();
+        }
+    }
+
+    // Tombstone an item in place; no other item moves
+    void erase(int handle) {
+        deadStringBytes += stringBytes((*this)[handle]);
+        dropDetails(handle);
+        (*this)[handle] = GeneralItem();
+        alive[handle] = false;
+        deadCount++;
+        trimDeadTail();
+    }
+
+    // Fill the hole with the last item instead of leaving a tombstone. Returns
+    // the new handle of the moved item, or -1 if nothing had to move.
+    int swapRemove(int handle) {
+        int last = count - 1;
+        if (handle == last) {
+            erase(handle);
+            return -1;
+        }
+        deadStringBytes += stringBytes((*this)[handle]);
+        dropDetails(handle);
+        (*this)[handle] = std::move((*this)[last]);
+        moveDetails(last, handle);
+        pop_back();
+        trimDeadTail();
+        return handle;
+    }
+
+    // Slide live items down over the tombstones, keeping their order. Returns
+    // the old handle -> new handle mapping (-1 for tombstones).
+    vector<int> compact() {
+        vector<int> remap(count, -1);
+        int next = 0;
+        for (int i = 0; i < count; i++) {
+            if (!alive[i]) continue;
+            if (i != next) {
+                (*this)[next] = std::move((*this)[i]);
+                moveDetails(i, next);
+                alive[next] = true;
+            }
+            remap[i] = next++;
+        }
+        while (count > next) {
+            pop_back();
+        }
+        deadCount = 0;
+        return remap;
+    }
+
+    // Arena bytes still held by removed items
+    size_t wastedStringBytes() const { return deadStringBytes; }
+    size_t stringBytesAllocated() const { return strings.bytesAllocated(); }
+
+    // Copy the live items' strings into a fresh arena, dropping the space held
+    // by removed items. Every view into the old arena becomes invalid.
+    void compactStrings() {
+        StringArena old = std::move(strings);
+        strings = StringArena();
+        categoryNames.clear();
+        for (int i = 0; i < count; i++) {
+            if (alive[i]) storeStrings((*this)[i]);
+        }
+        auto restore = [&](auto &pool) {
+            for (auto &value : pool.values) storeStrings(value);
+        };
+        apply([&](auto &...pool) { (restore(pool), ...); }, pools);
+        deadStringBytes = 0;
+    }
+};
+
+// Fixed set of worker threads that split a job into numbered tasks. Threads
+// (including the caller) pull the next unclaimed task from a shared counter,
+// so a thread that finishes early picks up work instead of sitting idle.
+class ThreadPool {
+private:
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake, done;
+    const function<void(int)> *job = nullptr;
+    int taskCount = 0;
+    atomic<int> nextTask{0};
+    int busyWorkers = 0;
+    long generation = 0;
+    bool stopping = false;
+
+    void drain(const function<void(int)> &fn, int tasks) {
+        for (int task = nextTask.fetch_add(1); task < tasks; task = nextTask.fetch_add(1)) {
+            fn(task);
+        }
+    }
+
+    void workerLoop() {
+        long seen = 0;
+        while (true) {
+            const function<void(int)> *fn;
+            int tasks;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                fn = job;
+                tasks = taskCount;
+            }
+            drain(*fn, tasks);
+            {
+                lock_guard<mutex> guard(lock);
+                if (--busyWorkers == 0) done.notify_one();
+            }
+        }
+    }
+
+public:
+    // threadCount is the total number of threads, counting the caller of run()
+    explicit ThreadPool(int threadCount) {
+        for (int i = 1; i < threadCount; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread &worker : workers) worker.join();
+    }
+
+    int size() const { return (int)workers.size() + 1; }
+
+    // Run fn(0) .. fn(tasks - 1) across the pool and wait for all of them
+    void run(int tasks, const function<void(int)> &fn) {
+        if (workers.empty() || tasks <= 1) {
+            for (int task = 0; task < tasks; task++) fn(task);
+            return;
+        }
+        {
+            lock_guard<mutex> guard(lock);
+            job = &fn;
+            taskCount = tasks;
+            nextTask = 0;
+            busyWorkers = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        drain(fn, tasks);
+        unique_lock<mutex> guard(lock);
+        done.wait(guard, [&] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+};
+
+// Operation metrics: per-operation counts and latency histograms. Build with
+// -DINVENTORY_METRICS=0 to compile them out; the timers then do nothing.
+#ifndef INVENTORY_METRICS
+#define INVENTORY_METRICS 1
+#endif
+
+// Operations with their own count and latency histogram. An operation that
+// runs another (a remove looks its ID up) counts in both.
+enum MetricOperation : uint8_t {
+    METRIC_ADD,
+    METRIC_LOOKUP,    // ID lookup
+    METRIC_UPDATE,    // Price or quantity set
+    METRIC_STOCK,     // Stock transaction
+    METRIC_REMOVE,
+    METRIC_SORT,      // Sorted view, rebuilt when stale
+    METRIC_CATEGORY,  // Items of a category
+    METRIC_LOW_STOCK,
+    METRIC_QUERY,     // Price/quantity range, prefix, substring, kind and expiry queries
+    METRIC_DISPLAY,   // Rendering item tables
+    METRIC_IMPORT,
+    METRIC_SAVE,
+    METRIC_LOAD,
+    METRIC_OPERATION_COUNT
+};
+
+const char *const METRIC_OPERATION_NAMES[METRIC_OPERATION_COUNT] = {
+    "add", "lookup", "update", "stock", "remove", "sort", "category", "low_stock", "query", "display",
+    "import", "save", "load"};
+
+// Every call is counted, but the cheap, frequent operations only have one call
+// in this many timed: the clock reads around a sub-microsecond call stop the
+// CPU from overlapping it with the next one and would double its cost.
+const uint32_t METRIC_SAMPLE_INTERVALS[METRIC_OPERATION_COUNT] = {16, 16, 16, 1, 16, 1, 1, 1, 1, 1, 1, 1, 1};
+
+// Latency histogram with HDR-style log-linear buckets: one per nanosecond
+// below 16 ns, then 16 per power of two, so any value is known to within
+// 1/16 of itself.
+struct LatencyHistogram {
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    vector<uint64_t> counts = vector<uint64_t>(BUCKETS);
+    uint64_t count = 0;      // Timed calls
+    uint64_t totalNs = 0;    // Time of the timed calls
+    uint64_t maxNs = 0;
+    uint64_t operations = 0; // All calls, timed or not
+
+    // Time of all calls, estimated from the timed ones
+    double estimatedTotalNs() const { return count == 0 ? 0 : (double)totalNs * operations / count; }
+
+    static int bucketOf(uint64_t ns) {
+        if (ns < (uint64_t)SUB_BUCKETS) return (int)ns;
+        int exponent = 63 - __builtin_clzll(ns);
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS
+               + (int)((ns >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    }
+
+    // Largest value that falls in a bucket
+    static uint64_t bucketLimit(int bucket) {
+        if (bucket < SUB_BUCKETS) return (uint64_t)bucket;
+        int shift = bucket / SUB_BUCKETS - 1;
+        uint64_t low = (uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+        return low + ((uint64_t)1 << shift) - 1;
+    }
+
+    // Upper bound of the value below which the given fraction of samples fall
+    uint64_t percentile(double fraction) const {
+        uint64_t rank = max<uint64_t>(1, (uint64_t)ceil(fraction * count));
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += counts[b];
+            if (seen >= rank) return min(bucketLimit(b), maxNs);
+        }
+        return maxNs;
+    }
+};
+
+// Bytes currently allocated from the heap, for the memory report
+size_t heapBytesInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+#if INVENTORY_METRICS
+// Where the operation timers record. Each thread records into a block of
+// counters of its own, with plain loads and stores and no lock; reading merges
+// the blocks of all threads, including the ones that have exited since.
+class Metrics {
+private:
+    struct ThreadBlock {
+        atomic<uint64_t> operations[METRIC_OPERATION_COUNT];
+        atomic<uint64_t> counts[METRIC_OPERATION_COUNT][LatencyHistogram::BUCKETS];
+        atomic<uint64_t> totalNs[METRIC_OPERATION_COUNT];
+        atomic<uint64_t> maxNs[METRIC_OPERATION_COUNT];
+    };
+
+    // Registers the thread's block on its first recording; folds it into retired when the thread exits
+    struct ThreadHandle {
+        ThreadBlock *block;
+
+        ThreadHandle() : block(new ThreadBlock()) {
+            Metrics &metrics = instance();
+            lock_guard<mutex> hold(metrics.lock);
+            metrics.blocks.push_back(block);
+        }
+
+        ~ThreadHandle() {
+            Metrics &metrics = instance();
+            lock_guard<mutex> hold(metrics.lock);
+            metrics.addBlock(*block, metrics.retired);
+            metrics.blocks.erase(find(metrics.blocks.begin(), metrics.blocks.end(), block));
+            delete block;
+        }
+    };
+
+    mutex lock;
+    vector<ThreadBlock *> blocks;
+    vector<LatencyHistogram> retired = vector<LatencyHistogram>(METRIC_OPERATION_COUNT);
+
+    static Metrics &instance() {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    static void addBlock(const ThreadBlock &block, vector<LatencyHistogram> &histograms) {
+        for (int op = 0; op < METRIC_OPERATION_COUNT; op++) {
+            LatencyHistogram &histogram = histograms[op];
+            for (int b = 0; b < LatencyHistogram::BUCKETS; b++) {
+                uint64_t n = block.counts[op][b].load(memory_order_relaxed);
+                histogram.counts[b] += n;
+                histogram.count += n;
+            }
+            histogram.operations += block.operations[op].load(memory_order_relaxed);
+            histogram.totalNs += block.totalNs[op].load(memory_order_relaxed);
+            histogram.maxNs = max(histogram.maxNs, block.maxNs[op].load(memory_order_relaxed));
+        }
+    }
+
+    static ThreadBlock &threadBlock() {
+        thread_local ThreadHandle handle;
+        return *handle.block;
+    }
+
+    // Only the owning thread writes a block, so no read-modify-write is needed
+    static uint64_t bump(atomic<uint64_t> &counter, uint64_t by = 1) {
+        uint64_t value = counter.load(memory_order_relaxed);
+        counter.store(value + by, memory_order_relaxed);
+        return value;
+    }
+
+public:
+    // Count a call; true if it should be timed and passed to record
+    static bool begin(MetricOperation operation) {
+        return bump(threadBlock().operations[operation]) % METRIC_SAMPLE_INTERVALS[operation] == 0;
+    }
+
+    static void record(MetricOperation operation, uint64_t ns) {
+        ThreadBlock &block = threadBlock();
+        bump(block.counts[operation][LatencyHistogram::bucketOf(ns)]);
+        bump(block.totalNs[operation], ns);
+        if (ns > block.maxNs[operation].load(memory_order_relaxed)) block.maxNs[operation].store(ns, memory_order_relaxed);
+    }
+
+    // Histograms of every operation, indexed by MetricOperation, merged over all threads
+    static vector<LatencyHistogram> collect() {
+        Metrics &metrics = instance();
+        lock_guard<mutex> hold(metrics.lock);
+        vector<LatencyHistogram> histograms = metrics.retired;
+        for (const ThreadBlock *block : metrics.blocks) addBlock(*block, histograms);
+        return histograms;
+    }
+};
+
+// Counts one operation and, if it is sampled, times it from construction to
+// destruction. pause/resume leave out time spent waiting, such as for the
+// user between pages.
+class OperationTimer {
+private:
+    MetricOperation operation;
+    bool timed;
+    bool running;
+    chrono::steady_clock::time_point start;
+    chrono::steady_clock::duration elapsed{0};
+
+public:
+    explicit OperationTimer(MetricOperation counted)
+        : operation(counted), timed(Metrics::begin(counted)), running(timed) {
+        if (timed) start = chrono::steady_clock::now();
+    }
+    OperationTimer(const OperationTimer &) = delete;
+    OperationTimer &operator=(const OperationTimer &) = delete;
+
+    ~OperationTimer() {
+        if (!timed) return;
+        pause();
+        Metrics::record(operation, (uint64_t)chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+    }
+
+    void pause() {
+        if (running) elapsed += chrono::steady_clock::now() - start;
+        running = false;
+    }
+
+    void resume() {
+        if (timed && !running) start = chrono::steady_clock::now();
+        running = timed;
+    }
+};
+#else
+class OperationTimer {
+public:
+    explicit OperationTimer(MetricOperation) {}
+    void pause() {}
+    void resume() {}
+};
+#endif
+
+// What a change-feed event reports
+enum ChangeType : uint8_t {
+    CHANGE_ADD,    // New item; the old quantity and price are 0
+    CHANGE_UPDATE, // Quantity or price set
+    CHANGE_REMOVE  // Item removed; the new quantity and price are 0
+};
+
+// One item change as read from a ChangeFeed. Fixed size and trivially copyable
+// so it fits in a ring slot: IDs longer than MAX_ID bytes are cut, and
+// idLength keeps the full length.
+struct ChangeEvent {
+    static constexpr size_t MAX_ID = 45;
+    uint64_t sequence; // 1, 2, 3, ... in the order the changes were made
+    Money oldPrice, newPrice;
+    int32_t oldQuantity, newQuantity;
+    uint16_t idLength;
+    ChangeType type;
+    char id[MAX_ID];
+
+    string_view getId() const { return string_view(id, min<size_t>(idLength, MAX_ID)); }
+};
+
+// Bounded feed of item changes for readers on other threads (reorder bots,
+// dashboards, ...). The thread changing the inventory writes each event into a
+// ring of slots, each guarded by a seqlock like ConcurrentInventory's records,
+// and never waits for a reader. Readers keep their own position (ChangeCursor):
+// one that falls more than the ring's capacity behind loses the overwritten
+// events and is told how many.
+class ChangeFeed {
+private:
+    static constexpr size_t WORDS = sizeof(ChangeEvent) / sizeof(uint64_t);
+    static_assert(sizeof(ChangeEvent) % sizeof(uint64_t) == 0, "ChangeEvent must fill whole words");
+
+    struct Slot {
+        atomic<uint64_t> stamp;        // 2 x sequence of the event held; +1 while it is being written
+        atomic<uint64_t> words[WORDS]; // The event's bytes
+    };
+
+    unique_ptr<Slot[]> slots;
+    size_t mask;
+    atomic<uint64_t> published{0}; // Sequence of the last complete event
+
+    // Subscribers sleeping until the next event; the writer only notifies, never locks
+    mutable mutex wakeLock;
+    mutable condition_variable wakeUp;
+    mutable atomic<int> sleepers{0};
+
+public:
+    // capacity is rounded up to a power of two
+    explicit ChangeFeed(size_t capacity = 1 << 14) {
+        size_t size = 1;
+        while (size < max<size_t>(capacity, 2)) size *= 2;
+        slots.reset(new Slot[size]());
+        mask = size - 1;
+    }
+    ChangeFeed(const ChangeFeed &) = delete;
+    ChangeFeed &operator=(const ChangeFeed &) = delete;
+
+    size_t capacity() const { return mask + 1; }
+    uint64_t lastSequence() const { return published.load(memory_order_acquire); }
+
+    // Add an event. Only one thread may publish at a time.
+    void publish(ChangeType type, string_view id, int32_t oldQuantity, int32_t newQuantity, Money oldPrice, Money newPrice) {
+        ChangeEvent event = {};
+        event.sequence = published.load(memory_order_relaxed) + 1;
+        event.type = type;
+        event.oldQuantity = oldQuantity;
+        event.newQuantity = newQuantity;
+        event.oldPrice = oldPrice;
+        event.newPrice = newPrice;
+        event.idLength = (uint16_t)min<size_t>(id.size(), UINT16_MAX);
+        memcpy(event.id, id.data(), min(id.size(), ChangeEvent::MAX_ID));
+        uint64_t words[WORDS];
+        memcpy(words, &event, sizeof(event));
+
+        Slot &slot = slots[event.sequence & mask];
+        slot.stamp.store(2 * event.sequence + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        for (size_t w = 0; w < WORDS; w++) slot.words[w].store(words[w], memory_order_relaxed);
+        slot.stamp.store(2 * event.sequence, memory_order_release);
+        published.store(event.sequence, memory_order_release);
+        if (sleepers.load() > 0) wakeUp.notify_all();
+    }
+
+    // Copy out the event with the given sequence; false if it was overwritten
+    // (or is being overwritten) by a newer one
+    bool read(uint64_t sequence, ChangeEvent &event) const {
+        const Slot &slot = slots[sequence & mask];
+        if (slot.stamp.load(memory_order_acquire) != 2 * sequence) return false;
+        uint64_t words[WORDS];
+        for (size_t w = 0; w < WORDS; w++) words[w] = slot.words[w].load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.stamp.load(memory_order_relaxed) != 2 * sequence) return false;
+        memcpy(&event, words, sizeof(event));
+        return true;
+    }
+
+    // Sleep until an event after the given sequence is published, or for at most
+    // timeout (a wakeup racing with the check is only caught by the timeout)
+    void waitForEvent(uint64_t after, chrono::milliseconds timeout) const {
+        sleepers++;
+        if (lastSequence() <= after) {
+            unique_lock<mutex> hold(wakeLock);
+            wakeUp.wait_for(hold, timeout);
+        }
+        sleepers--;
+    }
+
+    // Wake every sleeping subscriber, e.g. to let one stop
+    void wakeAll() const { wakeUp.notify_all(); }
+};
+
+// A reader's position in a ChangeFeed; used by one thread
+class ChangeCursor {
+private:
+    const ChangeFeed &feed;
+    uint64_t nextSequence;
+    uint64_t missed = 0;
+
+public:
+    // Start after the events already published, or with the oldest one still held
+    explicit ChangeCursor(const ChangeFeed &source, bool fromOldest = false) : feed(source) {
+        uint64_t last = feed.lastSequence();
+        nextSequence = fromOldest && last >= feed.capacity() ? last - feed.capacity() + 1 : fromOldest ? 1 : last + 1;
+    }
+
+    // Read the next event; false when the reader has caught up
+    bool next(ChangeEvent &event) {
+        while (true) {
+            uint64_t last = feed.lastSequence();
+            if (nextSequence > last) return false;
+            uint64_t oldest = last >= feed.capacity() ? last - feed.capacity() + 1 : 1;
+            if (nextSequence < oldest) {
+                missed += oldest - nextSequence;
+                nextSequence = oldest;
+            }
+            if (feed.read(nextSequence++, event)) return true;
+            missed++; // Overwritten while we looked
+        }
+    }
+
+    uint64_t getPosition() const { return nextSequence - 1; } // Sequence of the last event read or skipped
+    uint64_t getMissed() const { return missed; }                // Events lost to falling behind
+};
+
+// Calls a function for every event of a ChangeFeed, in order, on a thread of
+// its own. A slow callback never holds up the inventory; the subscriber just
+// misses the events that were overwritten meanwhile (see getMissed).
+class ChangeSubscription {
+private:
+    const ChangeFeed &feed;
+    function<void(const ChangeEvent &)> callback;
+    ChangeCursor cursor;
+    atomic<bool> stopping{false};
+    atomic<uint64_t> missed{0};
+    thread worker;
+
+    void deliver() {
+        ChangeEvent event;
+        while (!stopping.load(memory_order_relaxed) && cursor.next(event)) {
+            missed.store(cursor.getMissed(), memory_order_relaxed);
+            callback(event);
+        }
+    }
+
+public:
+    ChangeSubscription(const ChangeFeed &source, function<void(const ChangeEvent &)> onChange)
+        : feed(source), callback(move(onChange)), cursor(source) {
+        worker = thread([this] {
+            while (!stopping.load()) {
+                deliver();
+                feed.waitForEvent(cursor.getPosition(), chrono::milliseconds(10));
+            }
+        });
+    }
+    ChangeSubscription(const ChangeSubscription &) = delete;
+    ChangeSubscription &operator=(const ChangeSubscription &) = delete;
+
+    ~ChangeSubscription() {
+        stopping = true;
+        feed.wakeAll();
+        worker.join();
+    }
+
+    uint64_t getMissed() const { return missed.load(memory_order_relaxed); }
+};
+
+// Frees nodes that readers on other threads may still be looking at once none
+// can be. A reader pins the current epoch while it holds nodes; a node taken
+// out of reach is retired with the epoch of that moment, which is then bumped,
+// and freed when every pinned reader pinned a later epoch. A reader pins
+// before taking the owner's lock to read nodes; retire and collect run under
+// that lock; unpin needs no lock.
+class EpochReclaimer {
+private:
+    static constexpr int MAX_READERS = 128;
+
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> epoch{0}; // Pinned epoch; 0 while the slot is free
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        void *node;
+        void (*destroy)(void *);
+    };
+
+    ReaderSlot readers[MAX_READERS];
+    atomic<uint64_t> epoch{1};
+    vector<Retired> retired;
+
+    // Readers waiting for a free slot
+    mutex waitLock;
+    condition_variable slotFreed;
+    atomic<int> waiters{0};
+
+public:
+    EpochReclaimer() = default;
+    EpochReclaimer(const EpochReclaimer &) = delete;
+    EpochReclaimer &operator=(const EpochReclaimer &) = delete;
+
+    ~EpochReclaimer() {
+        for (Retired &node : retired) node.destroy(node.node);
+    }
+
+    // Pin the current epoch in a free slot and return the slot. While all slots
+    // are taken the reader sleeps until one is unpinned (a wakeup racing with
+    // the check is only caught by the timeout); writers don't wait for it.
+    int pin() {
+        while (true) {
+            for (int slot = 0; slot < MAX_READERS; slot++) {
+                uint64_t free = 0;
+                if (readers[slot].epoch.compare_exchange_strong(free, epoch.load())) return slot;
+            }
+            waiters++;
+            {
+                unique_lock<mutex> hold(waitLock);
+                slotFreed.wait_for(hold, chrono::milliseconds(1));
+            }
+            waiters--;
+        }
+    }
+
+    void unpin(int slot) {
+        readers[slot].epoch.store(0, memory_order_release);
+        if (waiters.load() > 0) slotFreed.notify_all();
+    }
+
+    void retire(void *node, void (*destroy)(void *)) {
+        retired.push_back({epoch.fetch_add(1), node, destroy});
+    }
+
+    // Free the retired nodes no pinned reader can still reach
+    void collect() {
+        if (retired.empty()) return;
+        uint64_t oldest = UINT64_MAX;
+        for (ReaderSlot &reader : readers) {
+            uint64_t pinned = reader.epoch.load(memory_order_acquire);
+            if (pinned != 0) oldest = min(oldest, pinned);
+        }
+        size_t kept = 0;
+        for (Retired &node : retired) {
+            if (node.epoch < oldest) node.destroy(node.node);
+            else retired[kept++] = node;
+        }
+        retired.resize(kept);
+    }
+
+    size_t pending() const { return retired.size(); }
+};
+
+// Point-in-time versions of an inventory's items, for reports and audits that
+// must not hold up (or see half of) the changes made meanwhile. The rows live
+// in fixed-size chunks under a root, and a version is just a frozen root, so
+// taking one is O(1). The inventory's thread keeps changing the working
+// version, copying a chunk (and the root) the first time it touches one a
+// frozen version shares; a reader walks its Snapshot without any lock.
+//
+// The newest versions are kept for "as of" queries: one for each kept
+// snapshot and, with a history interval set, at most one per interval as items
+// change. A node no kept version uses any more is freed once no reader holds
+// it (see EpochReclaimer), and so are the strings of a removed item.
+class VersionedStore {
+public:
+    typedef chrono::system_clock Clock;
+
+    // Strings of one item, shared by every version that has it
+    struct ItemText {
+        string id, lowerId, name, details;
+        uint64_t version; // Working version that added the item
+    };
+
+    struct Row {
+        const ItemText *text; // Null for the row of a removed item
+        string_view category;
+        Money price;
+        int32_t quantity;
+        bool live;
+
+        string_view getId() const { return text->id; }
+        string_view getName() const { return text->name; }
+        string_view getDetails() const { return text->details; }
+    };
+
+    struct VersionInfo {
+        uint64_t number;
+        Clock::time_point time;
+    };
+
+private:
+    static constexpr int CHUNK_ROWS = 16; // Small, as a writer copies a whole chunk to change one row of it
+
+    // A node may change in place only while its version is the working one
+    struct Chunk {
+        uint64_t version;
+        Row rows[CHUNK_ROWS];
+    };
+
+    struct Root {
+        uint64_t version;
+        int rowCount = 0;
+        vector<Chunk *> chunks;
+    };
+
+    struct Version {
+        uint64_t number;
+        Clock::time_point time;
+        Root *root;
+    };
+
+    // A node (root, chunk or item text) replaced in working version `died`
+    // while kept versions still use it
+    struct DeadNode {
+        uint64_t died;
+        void *node;
+        void (*destroy)(void *);
+    };
+
+    template <typename Node>
+    static void destroyNode(void *node) { delete (Node *)node; }
+
+    mutable mutex lock; // Held briefly for each change and to take a snapshot
+    uint64_t current = 1; // Number of the working version
+    Root *root;
+    bool changed = false; // Working version differs from the newest frozen one
+    Version newest = {0, Clock::time_point(), nullptr}; // Newest frozen version, kept or not
+    deque<Version> history; // Kept versions, oldest first
+    deque<DeadNode> dead;
+    size_t maxVersions = 64;
+    Clock::duration interval = Clock::duration::zero(); // Zero: versions are only kept by snapshot()
+    EpochReclaimer reclaimer;
+
+    StringArena strings; // Category names, kept for the store's lifetime
+    unordered_set<string_view> categoryNames;
+    unordered_map<string_view, int> rowOf; // Lowercased ID (held by the item's text) -> row of a live item
+    vector<int> freeRows;                  // Rows of removed items, for reuse
+
+    // A node created in version `born` was replaced in the working version: keep
+    // it while a kept version uses it, otherwise hand it to the reclaimer for
+    // the readers that may still hold it
+    template <typename Node>
+    void discard(Node *node, uint64_t born) {
+        if (!history.empty() && history.back().number >= born) {
+            dead.push_back({current, (void *)node, destroyNode<Node>});
+        } else {
+            reclaimer.retire((void *)node, destroyNode<Node>);
+        }
+    }
+
+    Root *writableRoot() {
+        if (root->version != current) {
+            Root *copy = new Root(*root);
+            copy->version = current;
+            discard(root, root->version);
+            root = copy;
+        }
+        return root;
+    }
+
+    Row &writableRow(int row) {
+        Root *working = writableRoot();
+        size_t c = row / CHUNK_ROWS;
+        if (c == working->chunks.size()) {
+            working->chunks.push_back(new Chunk());
+            working->chunks.back()->version = current;
+        }
+        Chunk *&chunk = working->chunks[c];
+        if (chunk->version != current) {
+            Chunk *copy = new Chunk(*chunk);
+            copy->version = current;
+            discard(chunk, chunk->version);
+            chunk = copy;
+        }
+        changed = true;
+        return chunk->rows[row % CHUNK_ROWS];
+    }
+
+    // Freeze the working version unless it is unchanged since the newest frozen
+    // one. Caller holds lock.
+    void freeze(Clock::time_point now) {
+        if (!changed && newest.root) return;
+        newest = {current, now, root};
+        current++;
+        changed = false;
+    }
+
+    // Freeze the working version and add it to the history, dropping the oldest
+    // versions past the limit. Caller holds lock.
+    void keep(Clock::time_point now) {
+        freeze(now);
+        if (!history.empty() && history.back().number == newest.number) return;
+        history.push_back({newest.number, now, newest.root});
+        while (history.size() > maxVersions) history.pop_front();
+        while (!dead.empty() && dead.front().died <= history.front().number) {
+            reclaimer.retire(dead.front().node, dead.front().destroy);
+            dead.pop_front();
+        }
+        reclaimer.collect();
+    }
+
+    // With a history interval, keep the items as they were before this change
+    // if the newest kept version is older than the interval. Caller holds lock.
+    void beforeChange() {
+        if (interval == Clock::duration::zero() || !changed) return;
+        Clock::time_point now = Clock::now();
+        if (history.empty() || now - history.back().time >= interval) keep(now);
+    }
+
+    string_view storeCategory(string_view category) {
+        auto found = categoryNames.find(category);
+        if (found != categoryNames.end()) return *found;
+        return *categoryNames.insert(strings.store(category)).first;
+    }
+
+public:
+    // The items of one version, readable from any thread for as long as it is
+    // held; the store must outlive it
+    class Snapshot {
+    private:
+        friend class VersionedStore;
+        EpochReclaimer *reclaimer = nullptr;
+        int slot = -1;
+        const Root *root = nullptr;
+        VersionInfo info = {0, Clock::time_point()};
+
+    public:
+        Snapshot() = default;
+        Snapshot(Snapshot &&other) noexcept { *this = move(other); }
+        Snapshot &operator=(Snapshot &&other) noexcept {
+            if (this != &other) {
+                release();
+                reclaimer = other.reclaimer;
+                slot = other.slot;
+                root = other.root;
+                info = other.info;
+                other.reclaimer = nullptr;
+                other.root = nullptr;
+            }
+            return *this;
+        }
+        ~Snapshot() { release(); }
+
+        void release() {
+            if (reclaimer) reclaimer->unpin(slot);
+            reclaimer = nullptr;
+            root = nullptr;
+        }
+
+        bool valid() const { return root != nullptr; }
+        uint64_t getVersion() const { return info.number; }
+        Clock::time_point getTime() const { return info.time; }
+
+        // Call a function for the row of every item in the version
+        template <typename Function>
+        void forEachItem(Function function) const {
+            if (!root) return;
+            for (int row = 0; row < root->rowCount; row++) {
+                const Row &item = root->chunks[row / CHUNK_ROWS]->rows[row % CHUNK_ROWS];
+                if (item.live) function(item);
+            }
+        }
+    };
+
+    VersionedStore() : root(new Root()) { root->version = current; }
+    VersionedStore(const VersionedStore &) = delete;
+    VersionedStore &operator=(const VersionedStore &) = delete;
+
+    // No Snapshot may be held any more
+    ~VersionedStore() {
+        // Everything the working and kept versions use, plus the dead nodes
+        // (which may be among them); the reclaimer frees what it holds
+        unordered_map<void *, void (*)(void *)> nodes;
+        vector<Root *> roots = {root};
+        for (Version &version : history) roots.push_back(version.root);
+        for (Root *node : roots) {
+            nodes.emplace(node, destroyNode<Root>);
+            for (Chunk *chunk : node->chunks) {
+                if (!nodes.emplace(chunk, destroyNode<Chunk>).second) continue;
+                for (Row &row : chunk->rows) {
+                    if (row.live) nodes.emplace((void *)row.text, destroyNode<const ItemText>);
+                }
+            }
+        }
+        for (DeadNode &node : dead) nodes.emplace(node.node, node.destroy);
+        for (auto &node : nodes) node.second(node.first);
+    }
+
+    // Keep at most the given number of versions, and with a nonzero interval
+    // record one automatically at most that often while items change
+    void setHistory(size_t versions, Clock::duration everyInterval) {
+        lock_guard<mutex> hold(lock);
+        maxVersions = max<size_t>(versions, 1);
+        interval = everyInterval;
+    }
+
+    // Changes, made by the inventory's thread
+
+    void add(string_view id, string_view lowerId, string_view name, string_view category, string_view details,
+             int32_t quantity, Money price) {
+        lock_guard<mutex> hold(lock);
+        beforeChange();
+        int row = root->rowCount;
+        if (!freeRows.empty()) {
+            row = freeRows.back();
+            freeRows.pop_back();
+        }
+        Row &target = writableRow(row);
+        if (row == root->rowCount) root->rowCount++;
+        ItemText *text = new ItemText{string(id), string(lowerId), string(name), string(details), current};
+        target.text = text;
+        target.category = storeCategory(category);
+        target.price = price;
+        target.quantity = quantity;
+        target.live = true;
+        rowOf[text->lowerId] = row;
+    }
+
+    void update(string_view lowerId, int32_t quantity, Money price) {
+        lock_guard<mutex> hold(lock);
+        auto found = rowOf.find(lowerId);
+        if (found == rowOf.end()) return;
+        beforeChange();
+        Row &target = writableRow(found->second);
+        target.quantity = quantity;
+        target.price = price;
+    }
+
+    void remove(string_view lowerId) {
+        lock_guard<mutex> hold(lock);
+        auto found = rowOf.find(lowerId);
+        if (found == rowOf.end()) return;
+        beforeChange();
+        Row &target = writableRow(found->second);
+        const ItemText *text = target.text;
+        target.live = false;
+        target.text = nullptr;
+        freeRows.push_back(found->second);
+        rowOf.erase(found);
+        discard(text, text->version);
+    }
+
+    // Remove every item
+    void clear() {
+        lock_guard<mutex> hold(lock);
+        beforeChange();
+        for (int row = 0; row < root->rowCount; row++) {
+            const Row &item = root->chunks[row / CHUNK_ROWS]->rows[row % CHUNK_ROWS];
+            if (item.live) discard(item.text, item.text->version);
+        }
+        for (Chunk *chunk : root->chunks) {
+            if (chunk->version == current) delete chunk; // Only the working version has it
+            else discard(chunk, chunk->version);
+        }
+        if (root->version == current) delete root;
+        else discard(root, root->version);
+        root = new Root();
+        root->version = current;
+        changed = true;
+        rowOf.clear();
+        freeRows.clear();
+    }
+
+    // Reads, from any thread
+
+    // The items as they are now. A kept snapshot also stays in the history for
+    // "as of" queries; one for a single report only lives as long as its readers.
+    Snapshot snapshot(bool keepVersion = true) {
+        int slot = reclaimer.pin(); // Before taking the lock, as it may wait for a free slot
+        lock_guard<mutex> hold(lock);
+        if (keepVersion) keep(Clock::now());
+        else freeze(Clock::now());
+        reclaimer.collect();
+        return pinned(slot, keepVersion ? history.back() : newest);
+    }
+
+    // The newest kept version published at or before the given time; not valid
+    // if the history doesn't reach back that far. Changes made since that
+    // version's time are missing from it, so with a history interval the
+    // answer is exact to within the interval.
+    Snapshot asOf(Clock::time_point time) {
+        int slot = reclaimer.pin();
+        lock_guard<mutex> hold(lock);
+        auto after = upper_bound(history.begin(), history.end(), time,
+                                 [](Clock::time_point t, const Version &version) { return t < version.time; });
+        if (after == history.begin()) {
+            reclaimer.unpin(slot);
+            return Snapshot();
+        }
+        return pinned(slot, *(after - 1));
+    }
+
+    // A kept version by number; not valid if it is no longer (or not yet) kept
+    Snapshot version(uint64_t number) {
+        int slot = reclaimer.pin();
+        lock_guard<mutex> hold(lock);
+        // Numbers have gaps: versions frozen for a single reader are not kept
+        auto found = lower_bound(history.begin(), history.end(), number,
+                                 [](const Version &version, uint64_t n) { return version.number < n; });
+        if (found == history.end() || found->number != number) {
+            reclaimer.unpin(slot);
+            return Snapshot();
+        }
+        return pinned(slot, *found);
+    }
+
+    vector<VersionInfo> versions() const {
+        lock_guard<mutex> hold(lock);
+        vector<VersionInfo> list;
+        for (const Version &version : history) list.push_back({version.number, version.time});
+        return list;
+    }
+
+    // Replaced nodes and removed items' strings waiting for old versions or their readers to go
+    size_t pendingNodes() const {
+        lock_guard<mutex> hold(lock);
+        return dead.size() + reclaimer.pending();
+    }
+
+private:
+    // Caller holds lock, and pinned the slot before taking it
+    Snapshot pinned(int slot, const Version &version) {
+        Snapshot snapshot;
+        snapshot.slot = slot;
+        snapshot.reclaimer = &reclaimer;
+        snapshot.root = version.root;
+        snapshot.info = {version.number, version.time};
+        return snapshot;
+    }
+};
+
+class Inventory {
+public:
+    // How removeItem fills the gap left by a removed item
+    enum RemovalPolicy {
+        PRESERVE_ORDER, // Leave a tombstone, compacted later in one pass
+        SWAP_REMOVE     // Move the last item into the gap (changes display order)
+    };
+
+    // Keys that items can be sorted by
+    enum SortKey { SORT_QUANTITY, SORT_PRICE, SORT_ID, SORT_NAME, SORT_KEY_COUNT };
+
+    // Text fields that can be searched by prefix or substring
+    enum TextField { TEXT_ID, TEXT_NAME, TEXT_FIELD_COUNT };
+
+private:
+    ItemStore items;
+    unordered_map<string_view, int> idIndex; // Lowercase item ID (held by items) -> position in items
+    RemovalPolicy removalPolicy = PRESERVE_ORDER;
+
+    // Cached item handles in ascending order per sort key. A view is built on
+    // first use and then kept in order as items are added, updated and removed.
+    vector<int> sortedViews[SORT_KEY_COUNT];
+    bool sortedViewBuilt[SORT_KEY_COUNT] = {};
+
+    // Trigram indexes for substring search, built on first use like the sorted views
+    TrigramIndex textIndexes[TEXT_FIELD_COUNT];
+    bool textIndexBuilt[TEXT_FIELD_COUNT] = {};
+
+    // Numeric fields in columnar form for the filter kernels, kept in step with items
+    ItemColumns columns;
+    CategoryDictionary categories;
+
+    // Handles of live items at or below their reorder threshold, in no
+    // particular order. Kept current as quantities and thresholds change.
+    vector<int> lowStock;
+
+    // Move a row in the columns and keep its category member list and watchlist entry pointing at it
+    void moveRow(int from, int to) {
+        columns.moveRow(from, to);
+        categories.moveMember(columns.categoryCode[to], columns.categoryPosition[to], to);
+        if (columns.lowStockPosition[to] != -1) lowStock[columns.lowStockPosition[to]] = to;
+    }
+
+    int thresholdOf(int handle) const {
+        int own = columns.reorderThreshold[handle];
+        return own >= 0 ? own : categories.threshold(columns.categoryCode[handle]);
+    }
+
+    // Add an item to or drop it from the watchlist after its quantity or threshold changed
+    void updateWatchlist(int handle) {
+        bool low = columns.quantity[handle] <= thresholdOf(handle);
+        int position = columns.lowStockPosition[handle];
+        if (low && position == -1) {
+            columns.lowStockPosition[handle] = (int)lowStock.size();
+            lowStock.push_back(handle);
+        } else if (!low && position != -1) {
+            removeFromWatchlist(handle);
+        }
+    }
+
+    void removeFromWatchlist(int handle) {
+        int position = columns.lowStockPosition[handle];
+        if (position == -1) return;
+        int last = lowStock.back();
+        lowStock[position] = last;
+        columns.lowStockPosition[last] = position;
+        lowStock.pop_back();
+        columns.lowStockPosition[handle] = -1;
+    }
+
+    // Add (sign 1) or take away (sign -1) an item's share of its category totals
+    void countInTotals(int handle, int sign) {
+        CategoryTotals &totals = categories.getTotals(columns.categoryCode[handle]);
+        totals.items += sign;
+        totals.quantity += sign * columns.quantity[handle];
+        totals.value += sign * columns.quantity[handle] * columns.price[handle];
+    }
+
+    // Set an item's quantity and keep the quantity view, totals and watchlist in step
+    void setQuantityAt(int handle, int newQuantity) {
+        publishChange(CHANGE_UPDATE, handle, columns.quantity[handle], newQuantity, columns.price[handle], columns.price[handle]);
+        viewErase(SORT_QUANTITY, handle);
+        countInTotals(handle, -1);
+        items[handle].updateQuantity(newQuantity);
+        columns.quantity[handle] = newQuantity;
+        countInTotals(handle, 1);
+        updateWatchlist(handle);
+        viewInsert(SORT_QUANTITY, handle);
+    }
+
+    void applyItemThreshold(int handle, int threshold) {
+        columns.reorderThreshold[handle] = threshold;
+        updateWatchlist(handle);
+    }
+
+    // Take an item out of its category's member list
+    void removeFromCategory(int handle) {
+        int moved = categories.removeMember(columns.categoryCode[handle], columns.categoryPosition[handle]);
+        if (moved != -1) {
+            columns.categoryPosition[moved] = columns.categoryPosition[handle];
+        }
+    }
+
+    // Durable storage: a snapshot file plus a write-ahead log of the mutations
+    // made since. Both are unset while the inventory lives only in memory.
+    unique_ptr<WriteAheadLog> wal;
+    string storagePath;
+    uint64_t sequence = 0;                // LSN of the last mutation applied
+    size_t autoCompactBytes = 64 << 20;   // Fold the log into a snapshot past this size
+    thread compactor;
+    atomic<bool> compacting{false};
+
+    void logMutation(LogRecordType type, const string &body) {
+        if (!wal) return;
+        uint64_t lsn = wal->append(type, body);
+        if (lsn == 0) return; // Not durable; the log has failed
+        sequence = lsn;
+        if (!compacting && wal->size() >= autoCompactBytes) compactLog();
+    }
+
+    // Apply one replayed log record; records that no longer apply are skipped
+    void applyLogRecord(uint8_t type, ByteReader &body) {
+        string id, name, category;
+        int32_t quantity;
+        Money price;
+        switch (type) {
+            case LOG_ADD: {
+                string detailText;
+                ItemDetails details;
+                if (body.readString(id) && body.readString(name) && body.read(quantity) && body.read(price)
+                    && body.readString(category) && body.readString(detailText) && parseDetails(detailText, details)) {
+                    addItem(id, name, quantity, price, category, details);
+                }
+                break;
+            }
+            case LOG_SET_PRICE:
+                if (body.readString(id) && body.read(price)) updatePrice(id, price);
+                break;
+            case LOG_SET_QUANTITY:
+                if (body.readString(id) && body.read(quantity)) updateQuantity(id, quantity);
+                break;
+            case LOG_REMOVE:
+                if (body.readString(id)) removeItem(id);
+                break;
+            case LOG_SET_ITEM_THRESHOLD:
+                if (body.readString(id) && body.read(quantity)) setItemThreshold(id, quantity);
+                break;
+            case LOG_SET_CATEGORY_THRESHOLD:
+                if (body.readString(category) && body.read(quantity)) setCategoryThreshold(category, quantity);
+                break;
+            case LOG_SET_QUANTITIES: {
+                // Read the whole transaction first; a record that doesn't parse is skipped entirely
+                uint32_t count;
+                if (!body.read(count)) break;
+                vector<pair<string, int32_t>> updates;
+                for (uint32_t u = 0; u < count; u++) {
+                    if (!body.readString(id) || !body.read(quantity)) return;
+                    updates.emplace_back(id, quantity);
+                }
+                for (const auto &update : updates) updateQuantity(update.first, update.second);
+                break;
+            }
+        }
+    }
+
+    // Worker threads for large sorts and scans; null when running single-threaded
+    unique_ptr<ThreadPool> pool;
+    static const int PARALLEL_MIN_ITEMS = 32768; // Smaller jobs aren't worth splitting
+
+    // Rows per page in the interactive item tables (0 = no paging)
+    size_t pageSize = 100;
+
+    // Feed of item changes; null (and nothing published) until getChangeFeed is first called
+    unique_ptr<ChangeFeed> changeFeed;
+
+    // Point-in-time versions of the items; null (and nothing recorded) until getVersionStore is first called
+    unique_ptr<VersionedStore> versions;
+
+    void publishChange(ChangeType type, int handle, int32_t oldQuantity, int32_t newQuantity, Money oldPrice, Money newPrice) {
+        if (changeFeed) changeFeed->publish(type, items[handle].getId(), oldQuantity, newQuantity, oldPrice, newPrice);
+        if (versions) recordVersion(type, handle, newQuantity, newPrice);
+    }
+
+    void recordVersion(ChangeType type, int handle, int32_t newQuantity, Money newPrice) {
+        const GeneralItem &item = items[handle];
+        if (type == CHANGE_ADD) {
+            versions->add(item.getId(), item.getLowerId(), item.getName(), item.getCategory(),
+                          formatDetails(items.details(handle)), newQuantity, newPrice);
+        } else if (type == CHANGE_UPDATE) {
+            versions->update(item.getLowerId(), newQuantity, newPrice);
+        } else {
+            versions->remove(item.getLowerId());
+        }
+    }
+
+    // Sort handles by a key, splitting the work across the pool for large inputs.
+    // The comparison is a total order, so the result is the same for any thread count.
+    void sortHandles(vector<int> &handles, SortKey key) {
+        auto less = [this, key](int a, int b) { return lessByKey(key, a, b); };
+        int n = (int)handles.size();
+        if (!pool || n < PARALLEL_MIN_ITEMS) {
+            sort(handles.begin(), handles.end(), less);
+            return;
+        }
+
+        // Sort one run per thread, then merge neighbouring runs pairwise
+        int runs = pool->size();
+        vector<int> bounds(runs + 1);
+        for (int r = 0; r <= runs; r++) bounds[r] = (int)((long long)n * r / runs);
+        pool->run(runs, [&](int r) {
+            sort(handles.begin() + bounds[r], handles.begin() + bounds[r + 1], less);
+        });
+
+        vector<int> buffer(n);
+        for (int width = 1; width < runs; width *= 2) {
+            int merges = (runs + 2 * width - 1) / (2 * width);
+            pool->run(merges, [&](int m) {
+                int lo = bounds[m * 2 * width];
+                int mid = bounds[min(runs, m * 2 * width + width)];
+                int hi = bounds[min(runs, m * 2 * width + 2 * width)];
+                merge(handles.begin() + lo, handles.begin() + mid, handles.begin() + mid, handles.begin() + hi,
+                      buffer.begin() + lo, less);
+            });
+            handles.swap(buffer);
+        }
+    }
+
+    // Run a filter kernel over all rows and clear the bits of tombstoned rows.
+    // Large scans are split into word-aligned blocks across the pool; each block
+    // writes its own part of the bitmap, so the result doesn't depend on threading.
+    vector<uint64_t> runFilter(const function<void(int begin, int end, uint64_t *bits)> &kernel) {
+        int n = columns.size();
+        vector<uint64_t> bits((n + 63) / 64);
+        auto filterBlock = [&](int begin, int end) {
+            kernel(begin, end, bits.data() + begin / 64);
+            for (int w = begin / 64; w < (end + 63) / 64; w++) bits[w] &= columns.liveBits[w];
+        };
+        if (!pool || n < PARALLEL_MIN_ITEMS) {
+            filterBlock(0, n);
+            return bits;
+        }
+
+        int blockSize = max(4096, n / (pool->size() * 8)) / 64 * 64;
+        int blocks = (n + blockSize - 1) / blockSize;
+        pool->run(blocks, [&](int b) { filterBlock(b * blockSize, min(n, (b + 1) * blockSize)); });
+        return bits;
+    }
+
+    // Stock value (quantity * price, in centavos) of the rows selected in a bitmap,
+    // summed in blocks across the pool for large inventories
+    Money sumSelectedValue(const vector<uint64_t> &bits) {
+        int n = columns.size();
+        const int32_t *quantity = columns.quantity.data();
+        const Money *price = columns.price.data();
+        if (!pool || n < PARALLEL_MIN_ITEMS) return sumValue(quantity, price, bits.data(), n);
+
+        int blockSize = max(4096, n / (pool->size() * 8)) / 64 * 64;
+        int blocks = (n + blockSize - 1) / blockSize;
+        vector<Money> partial(blocks);
+        pool->run(blocks, [&](int b) {
+            int begin = b * blockSize;
+            partial[b] = sumValue(quantity + begin, price + begin, bits.data() + begin / 64, min(n, begin + blockSize) - begin);
+        });
+        Money total = 0;
+        for (Money value : partial) total += value;
+        return total;
+    }
+
+    // Order two items by a sort key, falling back to the handle so the order is total
+    bool lessByKey(SortKey key, int a, int b) const {
+        int cmp = 0;
+        switch (key) {
+            case SORT_QUANTITY:
+                cmp = (items[a].getQuantity() > items[b].getQuantity()) - (items[a].getQuantity() < items[b].getQuantity());
+                break;
+            case SORT_PRICE:
+                cmp = (items[a].getPrice() > items[b].getPrice()) - (items[a].getPrice() < items[b].getPrice());
+                break;
+            case SORT_ID:
+                cmp = compareIgnoreCase(items[a].getId(), items[b].getId());
+                break;
+            case SORT_NAME:
+                cmp = compareIgnoreCase(items[a].getName(), items[b].getName());
+                break;
+            default:
+                break;
+        }
+        return cmp != 0 ? cmp < 0 : a < b;
+    }
+
+    // Position of a handle in a sorted view (or where it would be inserted)
+    vector<int>::iterator viewPosition(SortKey key, int handle) {
+        vector<int> &view = sortedViews[key];
+        return lower_bound(view.begin(), view.end(), handle,
+                           [this, key](int a, int b) { return lessByKey(key, a, b); });
+    }
+
+    void viewInsert(SortKey key, int handle) {
+        if (sortedViewBuilt[key]) {
+            sortedViews[key].insert(viewPosition(key, handle), handle);
+        }
+    }
+
+    // Must be called while the item still holds the values it was sorted by
+    void viewErase(SortKey key, int handle) {
+        if (sortedViewBuilt[key]) {
+            auto pos = viewPosition(key, handle);
+            if (pos != sortedViews[key].end() && *pos == handle) {
+                sortedViews[key].erase(pos);
+            }
+        }
+    }
+
+    string_view textOf(int handle, TextField field) const {
+        return field == TEXT_ID ? items[handle].getId() : items[handle].getName();
+    }
+
+    // Add an item to, or take it out of, every built sorted view and text index
+    void viewsInsert(int handle) {
+        for (int key = 0; key < SORT_KEY_COUNT; key++) viewInsert((SortKey)key, handle);
+        for (int field = 0; field < TEXT_FIELD_COUNT; field++) {
+            if (textIndexBuilt[field]) textIndexes[field].add(handle, textOf(handle, (TextField)field));
+        }
+    }
+
+    void viewsErase(int handle) {
+        for (int key = 0; key < SORT_KEY_COUNT; key++) viewErase((SortKey)key, handle);
+        for (int field = 0; field < TEXT_FIELD_COUNT; field++) {
+            if (!textIndexBuilt[field]) continue;
+            textIndexes[field].forget(textOf(handle, (TextField)field));
+            if (textIndexes[field].isMostlyStale()) {
+                textIndexes[field].clear(); // Rebuilt on next use
+                textIndexBuilt[field] = false;
+            }
+        }
+    }
+
+    TrigramIndex &getTextIndex(TextField field) {
+        if (!textIndexBuilt[field]) {
+            textIndexes[field].clear();
+            for (int i = 0; i < items.size(); i++) {
+                if (items.isAlive(i)) textIndexes[field].add(i, textOf(i, field));
+            }
+            textIndexBuilt[field] = true;
+        }
+        return textIndexes[field];
+    }
+
+    // Handles from a sorted view whose key lies between two bounds, optionally
+    // only those in one category. With a category, whichever is smaller of the
+    // range and the category's member list is walked.
+    template <typename T>
+    vector<int> findInRange(SortKey key, const vector<T> &column, T low, T high, const string &category) {
+        vector<int> found;
+        int code = -1;
+        if (!category.empty() && (code = categories.find(category)) == -1) return found;
+        const vector<int> &view = getSortedView(key);
+        auto first = lower_bound(view.begin(), view.end(), low, [&](int h, T value) { return column[h] < value; });
+        auto last = upper_bound(first, view.end(), high, [&](T value, int h) { return value < column[h]; });
+        if (code != -1 && (size_t)categories.getMembers(code).size() < (size_t)(last - first)) {
+            for (int handle : categories.getMembers(code)) {
+                if (column[handle] >= low && column[handle] <= high) found.push_back(handle);
+            }
+            sort(found.begin(), found.end(), [this, key](int a, int b) { return lessByKey(key, a, b); });
+            return found;
+        }
+        for (auto it = first; it != last; ++it) {
+            if (code == -1 || columns.categoryCode[*it] == code) found.push_back(*it);
+        }
+        return found;
+    }
+
+    // Compact once tombstones outnumber live items, so removal stays O(1) amortized.
+    // Likewise the string arena is rebuilt once removed items hold most of it.
+    void maybeCompact() {
+        if (items.tombstoneCount() >= 64 && items.tombstoneCount() > items.liveCount()) {
+            compact();
+        }
+        size_t wasted = items.wastedStringBytes();
+        if (wasted >= (1 << 20) && wasted > items.stringBytesAllocated() / 2) {
+            compactStrings();
+        }
+    }
+
+    // Move the item strings into a fresh arena; the ID index keys point into it
+    void compactStrings() {
+        items.compactStrings();
+        idIndex.clear();
+        for (int i = 0; i < items.size(); i++) {
+            if (items.isAlive(i)) idIndex[items[i].getLowerId()] = i;
+        }
+    }
+
+    // Remove the item at the given handle without compacting
+    void eraseItem(int handle, const string &lowerId) {
+        publishChange(CHANGE_REMOVE, handle, columns.quantity[handle], 0, columns.price[handle], 0);
+        idIndex.erase(lowerId);
+        viewsErase(handle);
+        countInTotals(handle, -1);
+        removeFromWatchlist(handle);
+        removeFromCategory(handle);
+        columns.setLive(handle, false);
+        if (removalPolicy == SWAP_REMOVE) {
+            int last = items.size() - 1;
+            if (last != handle) {
+                viewsErase(last); // The last item is about to change handle
+                moveRow(last, handle);
+            }
+            int moved = items.swapRemove(handle);
+            if (moved != -1) {
+                idIndex[items[moved].getLowerId()] = moved;
+                viewsInsert(moved);
+            }
+        } else {
+            items.erase(handle);
+        }
+        columns.resize(items.size()); // The store may have dropped trailing slots
+        if (wal) {
+            string body;
+            appendString(body, lowerId);
+            logMutation(LOG_REMOVE, body);
+        }
+    }
+
+public:
+    // getCategoryChoice results besides a category code
+    static const int CATEGORY_INVALID = -1;
+    static const int CATEGORY_RETURN = -2;
+    static const int CATEGORY_NEW = -3;
+
+    Inventory() {
+        // Default categories; more can be registered at runtime
+        registerCategory("Clothing");
+        registerCategory("Electronics");
+        registerCategory("Entertainment");
+    }
+
+    ~Inventory() {
+        closeStorage();
+    }
+
+    int getItemCount() const { return items.liveCount(); }
+    int getSlotCount() const { return items.size(); } // Live items plus tombstones
+    size_t getStringBytes() const { return items.stringBytesAllocated(); }
+    bool isItemLive(int handle) const { return items.isAlive(handle); }
+    GeneralItem &getItem(int handle) { return items[handle]; }
+    const GeneralItem &getItem(int handle) const { return items[handle]; }
+    ItemKind getKind(int handle) const { return items.kind(handle); }
+    ItemDetails getDetails(int handle) const { return items.details(handle); }
+
+    void setRemovalPolicy(RemovalPolicy policy) {
+        compact(); // Swap-remove assumes there are no tombstones
+        removalPolicy = policy;
+    }
+
+    // Drop all tombstones, keeping the remaining items in order
+    void compact() {
+        if (items.tombstoneCount() == 0) return;
+        vector<int> remap = items.compact();
+        for (int i = 0; i < (int)remap.size(); i++) {
+            if (remap[i] != -1 && remap[i] != i) moveRow(i, remap[i]);
+        }
+        columns.resize(items.size());
+        for (auto &entry : idIndex) {
+            entry.second = remap[entry.second];
+        }
+        // Compaction keeps items in order, so the views stay sorted after remapping
+        for (int key = 0; key < SORT_KEY_COUNT; key++) {
+            for (int &handle : sortedViews[key]) {
+                handle = remap[handle];
+            }
+        }
+        for (int field = 0; field < TEXT_FIELD_COUNT; field++) {
+            if (textIndexBuilt[field]) textIndexes[field].remap(remap);
+        }
+    }
+
+    // Item handles in ascending order of the given key
+    const vector<int> &getSortedView(SortKey key) {
+        OperationTimer timer(METRIC_SORT);
+        if (!sortedViewBuilt[key]) {
+            vector<int> &view = sortedViews[key];
+            view.clear();
+            view.reserve(items.liveCount());
+            for (int i = 0; i < items.size(); i++) {
+                if (items.isAlive(i)) view.push_back(i);
+            }
+            sortHandles(view, key);
+            sortedViewBuilt[key] = true;
+        }
+        return sortedViews[key];
+    }
+
+    // Release the cached sorted views and text indexes; they are rebuilt on next use
+    void clearSortedViews() {
+        for (int key = 0; key < SORT_KEY_COUNT; key++) {
+            sortedViews[key].clear();
+            sortedViews[key].shrink_to_fit();
+            sortedViewBuilt[key] = false;
+        }
+        for (int field = 0; field < TEXT_FIELD_COUNT; field++) {
+            textIndexes[field].clear();
+            textIndexBuilt[field] = false;
+        }
+    }
+
+    // Live items priced within [low, high], optionally only in one category, in price order.
+    // Uses the price view, so it costs O(log n + k) instead of a scan.
+    vector<int> findItemsByPrice(Money low, Money high, const string &category = "") {
+        OperationTimer timer(METRIC_QUERY);
+        return findInRange(SORT_PRICE, columns.price, low, high, category);
+    }
+
+    // Live items with a quantity within [low, high], optionally only in one category, in quantity order
+    vector<int> findItemsByQuantity(int low, int high, const string &category = "") {
+        OperationTimer timer(METRIC_QUERY);
+        return findInRange<int32_t>(SORT_QUANTITY, columns.quantity, low, high, category);
+    }
+
+    // Live items whose ID or name starts with a prefix (case-insensitive), in that field's order.
+    // Matches are next to each other in the sorted view, so this is a binary search plus the matches.
+    vector<int> findItemsByPrefix(TextField field, const string &prefix) {
+        OperationTimer timer(METRIC_QUERY);
+        const vector<int> &view = getSortedView(field == TEXT_ID ? SORT_ID : SORT_NAME);
+        auto first = lower_bound(view.begin(), view.end(), prefix, [&](int h, const string &text) {
+            return compareIgnoreCase(textOf(h, field), text) < 0;
+        });
+        vector<int> found;
+        for (auto it = first; it != view.end() && startsWithIgnoreCase(textOf(*it, field), prefix); ++it) {
+            found.push_back(*it);
+        }
+        return found;
+    }
+
+    // Live items whose ID or name contains a piece of text (case-insensitive), in storage order.
+    // Text of three or more characters is looked up in the trigram index; shorter text is scanned for.
+    vector<int> findItemsContaining(TextField field, const string &text) {
+        OperationTimer timer(METRIC_QUERY);
+        vector<int> found;
+        if (text.size() < 3) {
+            for (int i = 0; i < items.size(); i++) {
+                if (items.isAlive(i) && containsIgnoreCase(textOf(i, field), text)) found.push_back(i);
+            }
+            return found;
+        }
+        for (int handle : getTextIndex(field).candidates(text)) {
+            if (handle < items.size() && items.isAlive(handle) && containsIgnoreCase(textOf(handle, field), text)) {
+                found.push_back(handle);
+            }
+        }
+        sort(found.begin(), found.end());
+        found.erase(unique(found.begin(), found.end()), found.end());
+        return found;
+    }
+
+    // Live items of one kind, in storage order
+    vector<int> findItemsByKind(ItemKind kind) {
+        OperationTimer timer(METRIC_QUERY);
+        vector<int> found;
+        switch (kind) {
+            case KIND_PERISHABLE: found = items.pool<PerishableDetails>().owners; break;
+            case KIND_ELECTRONIC: found = items.pool<ElectronicDetails>().owners; break;
+            case KIND_CLOTHING: found = items.pool<ClothingDetails>().owners; break;
+            default:
+                for (int i = 0; i < items.size(); i++) {
+                    if (items.isAlive(i) && items.kind(i) == KIND_GENERAL) found.push_back(i);
+                }
+                break;
+        }
+        sort(found.begin(), found.end());
+        return found;
+    }
+
+    // Perishable items expiring on or before a day (days since 1970-01-01),
+    // soonest first. Only the perishable pool is read.
+    vector<int> findItemsExpiringBy(int32_t lastDay) {
+        OperationTimer timer(METRIC_QUERY);
+        const DetailPool<PerishableDetails> &perishables = items.pool<PerishableDetails>();
+        vector<pair<int32_t, int>> expiring; // expiry day, handle
+        for (size_t k = 0; k < perishables.values.size(); k++) {
+            if (perishables.values[k].expiryDay <= lastDay) {
+                expiring.emplace_back(perishables.values[k].expiryDay, perishables.owners[k]);
+            }
+        }
+        sort(expiring.begin(), expiring.end());
+        vector<int> found;
+        found.reserve(expiring.size());
+        for (const auto &entry : expiring) found.push_back(entry.second);
+        return found;
+    }
+
+    // Use the given number of threads for large sorts and scans (1 = single-threaded)
+    void setThreadCount(int threadCount) {
+        pool.reset(threadCount > 1 ? new ThreadPool(threadCount) : nullptr);
+    }
+
+    int getThreadCount() const { return pool ? pool->size() : 1; }
+
+    void setPageSize(size_t rows) { pageSize = rows; }
+
+    // Feed of this inventory's item changes (adds, quantity and price updates,
+    // removals), created on first use. Call it from the thread that changes the
+    // inventory, before handing the feed to readers on other threads.
+    ChangeFeed &getChangeFeed() {
+        if (!changeFeed) changeFeed.reset(new ChangeFeed());
+        return *changeFeed;
+    }
+
+    // Versions of this inventory's items for consistent reports and "as of"
+    // queries, created (holding the current items) on first use. Like the
+    // change feed, create it on the inventory's thread before readers use it.
+    VersionedStore &getVersionStore() {
+        if (!versions) {
+            versions.reset(new VersionedStore());
+            for (int handle = 0; handle < items.size(); handle++) {
+                if (items.isAlive(handle)) recordVersion(CHANGE_ADD, handle, columns.quantity[handle], columns.price[handle]);
+            }
+        }
+        return *versions;
+    }
+
+    bool hasVersionStore() const { return versions != nullptr; }
+
+    // Selection bitmap of live items in a category
+    vector<uint64_t> selectCategory(const string &category) {
+        int found = categories.find(category);
+        if (found == -1) return vector<uint64_t>((columns.size() + 63) / 64);
+        uint16_t code = (uint16_t)found;
+        return runFilter([&](int begin, int end, uint64_t *bits) {
+            filterEqual(columns.categoryCode.data() + begin, end - begin, code, bits);
+        });
+    }
+
+    // Selection bitmap of live items at or below a stock threshold
+    vector<uint64_t> selectLowStock(int threshold) {
+        return runFilter([&](int begin, int end, uint64_t *bits) {
+            filterLessEqual(columns.quantity.data() + begin, end - begin, threshold, bits);
+        });
+    }
+
+    // Selection bitmap of live items priced within [low, high]
+    vector<uint64_t> selectPriceRange(Money low, Money high) {
+        return runFilter([&](int begin, int end, uint64_t *bits) {
+            filterRange(columns.price.data() + begin, end - begin, low, high, bits);
+        });
+    }
+
+    // Handles of live items in a category, in storage order. Uses the category's
+    // member list, so the cost depends on the category size, not the catalog size.
+    vector<int> findItemsByCategory(const string &category) {
+        OperationTimer timer(METRIC_CATEGORY);
+        int code = categories.find(category);
+        if (code == -1) return vector<int>();
+        vector<int> found = categories.getMembers(code);
+        sort(found.begin(), found.end());
+        return found;
+    }
+
+    // Register a category at runtime; returns its code, or -1 if there are too many
+    int registerCategory(const string &category) {
+        return categories.registerCategory(category);
+    }
+
+    const CategoryDictionary &getCategories() const { return categories; }
+
+    // Handles of live items at or below a stock threshold, in storage order
+    vector<int> findLowStockItems(int threshold) {
+        OperationTimer timer(METRIC_LOW_STOCK);
+        return bitmapToHandles(selectLowStock(threshold));
+    }
+
+    // Handles of live items priced within [low, high], in storage order
+    vector<int> findItemsInPriceRange(Money low, Money high) {
+        return bitmapToHandles(selectPriceRange(low, high));
+    }
+
+    // Value of all stock on hand, in centavos, from the running category totals
+    Money totalValue() const {
+        Money total = 0;
+        for (int code = 0; code < categories.size(); code++) total += categories.getTotals(code).value;
+        return total;
+    }
+
+    // Value of the stock in each category, in centavos, indexed by category code
+    vector<Money> valueByCategory() const {
+        vector<Money> values(categories.size());
+        for (int code = 0; code < categories.size(); code++) values[code] = categories.getTotals(code).value;
+        return values;
+    }
+
+    // Value of the items in a selection bitmap (e.g. from selectPriceRange), summed with a full scan
+    Money valueOf(const vector<uint64_t> &selection) {
+        return sumSelectedValue(selection);
+    }
+
+    // Handles of the items at or below their reorder threshold, in storage order.
+    // Reads the watchlist, so the cost depends on the number of low-stock items.
+    vector<int> getLowStockItems() const {
+        OperationTimer timer(METRIC_LOW_STOCK);
+        vector<int> found = lowStock;
+        sort(found.begin(), found.end());
+        return found;
+    }
+
+    // Reorder threshold an item is checked against: its own, or else its category's
+    int getReorderThreshold(int handle) const { return thresholdOf(handle); }
+
+    // Set a category's reorder threshold; returns false if the category doesn't exist
+    bool setCategoryThreshold(const string &category, int threshold) {
+        int code = categories.find(category);
+        if (code == -1 || threshold < 0) return false;
+        categories.setThreshold(code, threshold);
+        for (int handle : categories.getMembers(code)) updateWatchlist(handle);
+        if (wal) {
+            string body;
+            int32_t value = threshold;
+            appendString(body, categories.name(code));
+            appendBytes(body, &value, sizeof(value));
+            logMutation(LOG_SET_CATEGORY_THRESHOLD, body);
+        }
+        return true;
+    }
+
+    // Give an item its own reorder threshold by its already-lowercased ID, or pass
+    // -1 to go back to the category's. Returns false if the item is not found.
+    bool setItemThreshold(const string &lowerId, int threshold) {
+        int handle = findItem(lowerId);
+        if (handle == -1 || threshold < -1) return false;
+        applyItemThreshold(handle, threshold);
+        if (wal) {
+            string body;
+            int32_t value = threshold;
+            appendString(body, lowerId);
+            appendBytes(body, &value, sizeof(value));
+            logMutation(LOG_SET_ITEM_THRESHOLD, body);
+        }
+        return true;
+    }
+
+    // Change an item's price by its already-lowercased ID; returns false if not found
+    bool updatePrice(const string &lowerId, Money newPrice) {
+        OperationTimer timer(METRIC_UPDATE);
+        int handle = findItem(lowerId);
+        if (handle == -1) return false;
+        publishChange(CHANGE_UPDATE, handle, columns.quantity[handle], columns.quantity[handle], columns.price[handle], newPrice);
+        viewErase(SORT_PRICE, handle);
+        countInTotals(handle, -1);
+        items[handle].updatePrice(newPrice);
+        columns.price[handle] = newPrice;
+        countInTotals(handle, 1);
+        viewInsert(SORT_PRICE, handle);
+        if (wal) {
+            string body;
+            appendString(body, lowerId);
+            appendBytes(body, &newPrice, sizeof(newPrice));
+            logMutation(LOG_SET_PRICE, body);
+        }
+        return true;
+    }
+
+    // Change an item's quantity by its already-lowercased ID; returns false if not found
+    bool updateQuantity(const string &lowerId, int newQuantity) {
+        OperationTimer timer(METRIC_UPDATE);
+        int handle = findItem(lowerId);
+        if (handle == -1) return false;
+        setQuantityAt(handle, newQuantity);
+        if (wal) {
+            string body;
+            int32_t quantity = newQuantity;
+            appendString(body, lowerId);
+            appendBytes(body, &quantity, sizeof(quantity));
+            logMutation(LOG_SET_QUANTITY, body);
+        }
+        return true;
+    }
+
+    // Apply a stock transaction, e.g. -3 on one item and +10 on another, as a
+    // whole: if any ID is unknown or any quantity would go below zero, nothing
+    // changes and *error says why. IDs are matched case-insensitively and
+    // several changes to the same item are added up. The transaction is logged
+    // as one record, so a crash never leaves half of it applied.
+    bool applyStockChanges(const vector<StockChange> &changes, string *error = nullptr) {
+        OperationTimer timer(METRIC_STOCK);
+        // Look each ID up once, then order by handle so repeats sit together
+        vector<pair<int, size_t>> lookups; // handle, index into changes
+        vector<string> lowerIds(changes.size());
+        lookups.reserve(changes.size());
+        for (size_t i = 0; i < changes.size(); i++) {
+            lowerIds[i] = toLowerCase(changes[i].id);
+            int handle = findItem(lowerIds[i]);
+            if (handle == -1) {
+                if (error) *error = "item ID " + changes[i].id + " not found";
+                return false;
+            }
+            lookups.emplace_back(handle, i);
+        }
+        sort(lookups.begin(), lookups.end());
+
+        // Work out every new quantity before touching anything
+        vector<pair<int, int>> updates; // handle, new quantity
+        vector<size_t> firstChange;     // Which change names each updated item
+        for (size_t i = 0; i < lookups.size();) {
+            int handle = lookups[i].first;
+            long long quantity = columns.quantity[handle];
+            size_t first = lookups[i].second;
+            for (; i < lookups.size() && lookups[i].first == handle; i++) {
+                quantity += changes[lookups[i].second].delta;
+            }
+            if (quantity < 0 || quantity > INT32_MAX) {
+                if (error) {
+                    *error = "item ID " + changes[first].id + (quantity < 0 ? " would go below zero" : " would overflow")
+                             + " (has " + to_string(columns.quantity[handle]) + ")";
+                }
+                return false;
+            }
+            updates.emplace_back(handle, (int)quantity);
+            firstChange.push_back(first);
+        }
+
+        for (const auto &update : updates) setQuantityAt(update.first, update.second);
+        if (wal && !updates.empty()) {
+            string body;
+            uint32_t count = updates.size();
+            appendBytes(body, &count, sizeof(count));
+            for (size_t u = 0; u < updates.size(); u++) {
+                int32_t quantity = updates[u].second;
+                appendString(body, lowerIds[firstChange[u]]);
+                appendBytes(body, &quantity, sizeof(quantity));
+            }
+            logMutation(LOG_SET_QUANTITIES, body);
+        }
+        return true;
+    }
+
+    // Remove an item by its already-lowercased ID; returns false if not found
+    bool removeItem(const string &lowerId) {
+        OperationTimer timer(METRIC_REMOVE);
+        int handle = findItem(lowerId);
+        if (handle == -1) return false;
+        eraseItem(handle, lowerId);
+        maybeCompact();
+        return true;
+    }
+
+    // Remove many items in one pass with at most one compaction at the end.
+    // Returns the number of items actually removed.
+    int removeItems(const vector<string> &lowerIds) {
+        OperationTimer timer(METRIC_REMOVE);
+        int removed = 0;
+        for (const string &lowerId : lowerIds) {
+            int handle = findItem(lowerId);
+            if (handle != -1) {
+                eraseItem(handle, lowerId);
+                removed++;
+            }
+        }
+        maybeCompact();
+        return removed;
+    }
+
+    // Reserve room for a bulk load of the given number of items
+    void reserve(int capacity) {
+        items.reserve(capacity);
+        columns.reserve(capacity);
+        // Grow the index geometrically so repeated batch reserves don't rehash every time
+        if (capacity > idIndex.bucket_count() * idIndex.max_load_factor()) {
+            idIndex.reserve(max((size_t)capacity, idIndex.size() * 2));
+        }
+    }
+
+    // Add an item without prompting; returns false if the ID is already taken
+    bool addItem(const string &id, const string &name, int quantity, Money price, const string &category,
+                 const ItemDetails &details = ItemDetails()) {
+        int code = categories.registerCategory(category);
+        return code != -1 && insertItem(id, name, quantity, price, code, details);
+    }
+
+    // Add an item to an already-registered category; returns false if the ID is already taken
+    bool insertItem(const string &id, const string &name, int quantity, Money price, int categoryCode,
+                    const ItemDetails &details = ItemDetails()) {
+        OperationTimer timer(METRIC_ADD);
+        string lowerId = toLowerCase(id);
+        if (idIndex.count(lowerId)) {
+            return false;
+        }
+        GeneralItem item;
+        item.setItem(id, name, quantity, price, categories.name(categoryCode));
+        item.setLowerId(lowerId);
+        int handle = items.push_back(item, details);
+        columns.push_back(quantity, price, (uint16_t)categoryCode, categories.addMember(categoryCode, handle));
+        countInTotals(handle, 1);
+        updateWatchlist(handle);
+        idIndex[items[handle].getLowerId()] = handle;
+        viewsInsert(handle);
+        publishChange(CHANGE_ADD, handle, 0, quantity, 0, price);
+        if (wal) {
+            string body;
+            int32_t itemQuantity = quantity;
+            appendString(body, id);
+            appendString(body, name);
+            appendBytes(body, &itemQuantity, sizeof(itemQuantity));
+            appendBytes(body, &price, sizeof(price));
+            appendString(body, categories.name(categoryCode));
+            appendString(body, formatDetails(details)); // Empty for a general item
+            logMutation(LOG_ADD, body);
+        }
+        return true;
+    }
+
+    // Remove every item, keeping the registered categories
+    void clear() {
+        items = ItemStore();
+        columns = ItemColumns();
+        idIndex.clear();
+        categories.clearMembers();
+        lowStock.clear();
+        clearSortedViews();
+        if (versions) versions->clear();
+    }
+
+    // Write all live items to a snapshot file (see SnapshotHeader for the layout).
+    // The file is replaced atomically. Returns false if it could not be written.
+    bool saveSnapshot(const string &path) {
+        OperationTimer timer(METRIC_SAVE);
+        vector<char> out;
+        buildSnapshot(out);
+        return writeFileAtomically(path, out.data(), out.size());
+    }
+
+    // Build the snapshot image of all live items in memory
+    void buildSnapshot(vector<char> &out) {
+        vector<int> live;
+        live.reserve(items.liveCount());
+        for (int i = 0; i < items.size(); i++) {
+            if (items.isAlive(i)) live.push_back(i);
+        }
+        uint64_t n = live.size(), c = categories.size();
+
+        // Items are renumbered densely in storage order
+        vector<int32_t> newIndex(items.size(), -1);
+        for (uint64_t i = 0; i < n; i++) newIndex[live[i]] = (int32_t)i;
+
+        uint64_t stringsSize = 0;
+        for (int handle : live) stringsSize += items[handle].getId().size() + items[handle].getName().size();
+        for (uint64_t k = 0; k < c; k++) stringsSize += categories.name((int)k).size();
+        vector<pair<int32_t, string>> detailTexts; // New index, text; only items that have details
+        for (int handle : live) {
+            if (items.kind(handle) != KIND_GENERAL) {
+                detailTexts.emplace_back(newIndex[handle], formatDetails(items.details(handle)));
+                stringsSize += detailTexts.back().second.size();
+            }
+        }
+
+        SnapshotHeader header = {};
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.headerSize = sizeof(SnapshotHeader);
+        header.itemCount = n;
+        header.categoryCount = c;
+        header.quantityOffset = alignSection(sizeof(SnapshotHeader));
+        header.priceOffset = header.quantityOffset + alignSection(n * sizeof(int32_t));
+        header.categoryOffset = header.priceOffset + alignSection(n * sizeof(Money));
+        header.idRefOffset = header.categoryOffset + alignSection(n * sizeof(uint16_t));
+        header.nameRefOffset = header.idRefOffset + n * sizeof(SnapshotStringRef);
+        header.categoryNameOffset = header.nameRefOffset + n * sizeof(SnapshotStringRef);
+        header.idOrderOffset = header.categoryNameOffset + c * sizeof(SnapshotStringRef);
+        header.itemThresholdOffset = header.idOrderOffset + alignSection(n * sizeof(int32_t));
+        header.categoryThresholdOffset = header.itemThresholdOffset + alignSection(n * sizeof(int32_t));
+        header.detailRefOffset = header.categoryThresholdOffset + alignSection(c * sizeof(int32_t));
+        header.stringsOffset = header.detailRefOffset + n * sizeof(SnapshotStringRef);
+        header.stringsSize = stringsSize;
+        header.sequence = sequence;
+
+        out.assign(header.stringsOffset + stringsSize, 0);
+        memcpy(out.data(), &header, sizeof(header));
+        int32_t *quantities = (int32_t *)(out.data() + header.quantityOffset);
+        Money *prices = (Money *)(out.data() + header.priceOffset);
+        uint16_t *codes = (uint16_t *)(out.data() + header.categoryOffset);
+        SnapshotStringRef *idRefs = (SnapshotStringRef *)(out.data() + header.idRefOffset);
+        SnapshotStringRef *nameRefs = (SnapshotStringRef *)(out.data() + header.nameRefOffset);
+        SnapshotStringRef *categoryRefs = (SnapshotStringRef *)(out.data() + header.categoryNameOffset);
+        int32_t *idOrder = (int32_t *)(out.data() + header.idOrderOffset);
+        int32_t *itemThresholds = (int32_t *)(out.data() + header.itemThresholdOffset);
+        int32_t *categoryThresholds = (int32_t *)(out.data() + header.categoryThresholdOffset);
+        SnapshotStringRef *detailRefs = (SnapshotStringRef *)(out.data() + header.detailRefOffset);
+        char *heap = out.data() + header.stringsOffset;
+
+        uint64_t heapUsed = 0;
+        auto putString = [&](string_view text, SnapshotStringRef &ref) {
+            memcpy(heap + heapUsed, text.data(), text.size());
+            ref.offset = heapUsed;
+            ref.length = (uint32_t)text.size();
+            heapUsed += text.size();
+        };
+        for (uint64_t i = 0; i < n; i++) {
+            int handle = live[i];
+            quantities[i] = columns.quantity[handle];
+            prices[i] = columns.price[handle];
+            codes[i] = columns.categoryCode[handle];
+            itemThresholds[i] = columns.reorderThreshold[handle];
+            putString(items[handle].getId(), idRefs[i]);
+            putString(items[handle].getName(), nameRefs[i]);
+        }
+        for (uint64_t k = 0; k < c; k++) {
+            putString(categories.name((int)k), categoryRefs[k]);
+            categoryThresholds[k] = categories.threshold((int)k);
+        }
+        for (const auto &entry : detailTexts) putString(entry.second, detailRefs[entry.first]);
+        // Use the ID view only if it is already kept; building it here would
+        // make every later add and remove pay to keep it sorted
+        const vector<int> *byId = &sortedViews[SORT_ID];
+        if (!sortedViewBuilt[SORT_ID]) {
+            sortHandles(live, SORT_ID);
+            byId = &live;
+        }
+        for (uint64_t i = 0; i < n; i++) idOrder[i] = newIndex[(*byId)[i]];
+    }
+
+    // Replace the inventory with the contents of a snapshot file. Returns false
+    // (leaving the inventory untouched) if the file cannot be read.
+    bool loadSnapshot(const string &path, string *error = nullptr) {
+        OperationTimer timer(METRIC_LOAD);
+        SnapshotView view;
+        if (!view.open(path)) {
+            if (error) *error = view.error();
+            return false;
+        }
+        int newCategories = 0;
+        for (int k = 0; k < view.categoryCount(); k++) {
+            if (categories.find(string(view.categoryName(k))) == -1) newCategories++;
+        }
+        if (categories.size() + newCategories > CategoryDictionary::MAX_CATEGORIES) {
+            if (error) *error = "too many categories";
+            return false;
+        }
+        unique_ptr<WriteAheadLog> log = std::move(wal); // Don't log the items as they are loaded
+        clear();
+        vector<int> codeMap(view.categoryCount());
+        for (int k = 0; k < view.categoryCount(); k++) {
+            codeMap[k] = registerCategory(string(view.categoryName(k)));
+            categories.setThreshold(codeMap[k], view.categoryThreshold(k));
+        }
+        int n = view.itemCount();
+        reserve(n);
+        for (int i = 0; i < n; i++) {
+            ItemDetails details;
+            parseDetails(view.details(i), details); // Checked when the snapshot was opened
+            bool added = insertItem(string(view.id(i)), string(view.name(i)), view.quantity(i), view.price(i),
+                                    codeMap[view.categoryCode(i)], details);
+            if (added && view.itemThreshold(i) != -1) applyItemThreshold(items.size() - 1, view.itemThreshold(i));
+        }
+        sequence = view.sequence();
+
+        wal = std::move(log);
+        if (wal) {
+            // The loaded items replace everything the log describes, so fold
+            // them into the storage snapshot right away
+            sequence = wal->lastLsn();
+            compactLog();
+        }
+        return true;
+    }
+
+    // Add a batch of items, registering new categories as needed. Logged adds
+    // share one fsync. Returns the number added; the indexes of records whose
+    // ID was already taken, or whose category there was no room for, go to rejected.
+    int addItems(const vector<ItemRecord> &batch, vector<size_t> *rejected = nullptr) {
+        reserve(items.size() + (int)batch.size());
+        if (wal) wal->beginBatch();
+        int added = 0;
+        for (size_t i = 0; i < batch.size(); i++) {
+            const ItemRecord &record = batch[i];
+            ItemDetails details;
+            parseDetails(record.details, details); // Records come checked by parseItemRecord
+            int code = registerCategory(record.category);
+            if (code != -1 && insertItem(record.id, record.name, record.quantity, record.price, code, details)) {
+                added++;
+            } else if (rejected) {
+                rejected->push_back(i);
+            }
+        }
+        if (wal) wal->endBatch();
+        return added;
+    }
+
+    // Stream items from a CSV file (or TSV, by .tsv extension) with the columns
+    // id, name, quantity, price, category, optionally details (see parseDetails),
+    // and an optional header row. Rows that fail validation are reported and
+    // skipped; the rest are added in batches. Returns false if the file cannot
+    // be opened.
+    bool importItems(const string &path, ImportReport &report) {
+        OperationTimer timer(METRIC_IMPORT);
+        const size_t BATCH_SIZE = 8192;
+        const size_t MAX_ERRORS = 100;
+
+        size_t dot = path.rfind('.');
+        bool tabSeparated = dot != string::npos && toLowerCase(path.substr(dot)) == ".tsv";
+        DelimitedReader reader(tabSeparated ? '\t' : ',');
+        if (!reader.open(path)) return false;
+
+        vector<ItemRecord> batch;
+        vector<long long> batchLines;
+        auto reject = [&](long long line, const string &reason) {
+            report.rowsRejected++;
+            if (report.errors.size() < MAX_ERRORS) report.errors.push_back("line " + to_string(line) + ": " + reason);
+        };
+        auto flushBatch = [&] {
+            vector<size_t> duplicates;
+            report.itemsAdded += addItems(batch, &duplicates);
+            for (size_t i : duplicates) {
+                reject(batchLines[i], categories.find(batch[i].category) == -1 ? "too many categories to add " + batch[i].category
+                                                                              : "item ID " + batch[i].id + " already exists");
+            }
+            batch.clear();
+            batchLines.clear();
+        };
+
+        vector<string_view> fields;
+        ItemRecord record;
+        string reason;
+        while (reader.nextRow(fields)) {
+            // Skip a header row such as "id,name,quantity,price,category"
+            if (report.rowsRead == 0 && report.rowsRejected == 0 && fields.size() >= 5
+                && toLowerCase(string(trimField(fields[0]))) == "id" && !isValidInteger(trimField(fields[2]))) {
+                continue;
+            }
+            report.rowsRead++;
+            if (!parseItemRecord(fields, record, reason)) {
+                reject(reader.getLineNumber(), reason);
+                continue;
+            }
+            batch.push_back(std::move(record));
+            batchLines.push_back(reader.getLineNumber());
+            if (batch.size() == BATCH_SIZE) flushBatch();
+        }
+        flushBatch();
+        return true;
+    }
+
+    // Keep the inventory in a snapshot file plus a write-ahead log next to it
+    // (path + ".wal"). Loads the snapshot if it exists, replays the log on top
+    // of it, and logs every later mutation.
+    bool openStorage(const string &path, string *error = nullptr) {
+        closeStorage();
+        clear();
+        sequence = 0;
+        if (::access(path.c_str(), F_OK) == 0 && !loadSnapshot(path, error)) {
+            return false;
+        }
+
+        string logPath = path + ".wal";
+        size_t validLength = WriteAheadLog::replay(logPath, [this](uint64_t lsn, uint8_t type, ByteReader &body) {
+            if (lsn <= sequence) return; // Already part of the snapshot
+            applyLogRecord(type, body);
+            sequence = lsn;
+        });
+
+        unique_ptr<WriteAheadLog> log = make_unique<WriteAheadLog>();
+        if (!log->open(logPath, validLength, sequence + 1)) {
+            if (error) *error = "cannot open " + logPath;
+            return false;
+        }
+        wal = std::move(log);
+        storagePath = path;
+        return true;
+    }
+
+    // Batch log fsyncs: up to records mutations per fsync, flushed at least
+    // every delayMs milliseconds
+    void setGroupCommit(int records, int delayMs = 10) {
+        if (wal) wal->setGroupCommit(records, delayMs);
+    }
+
+    // True once the write-ahead log failed to write or sync a record. Changes
+    // made since are only in memory, so callers should refuse further ones.
+    bool hasStorageFailed() const { return wal && wal->hasFailed(); }
+
+    // Fold the write-ahead log into a new snapshot. The snapshot image is taken
+    // here; writing it and trimming the covered records from the log happen on
+    // a background thread while mutations continue.
+    void compactLog() {
+        if (!wal) return;
+        waitForCompaction();
+        auto image = make_shared<vector<char>>();
+        buildSnapshot(*image);
+        WriteAheadLog *log = wal.get();
+        string path = storagePath;
+        uint64_t upToLsn = sequence;
+        compacting = true;
+        compactor = thread([this, log, path, image, upToLsn] {
+            // The snapshot must not get ahead of the durable log. A log that
+            // fails here or while being trimmed reports it through
+            // hasStorageFailed; one merely left untrimmed is still complete.
+            if (log->commit() && writeFileAtomically(path, image->data(), image->size())) {
+                log->truncateBefore(upToLsn);
+            }
+            compacting = false;
+        });
+    }
+
+    void waitForCompaction() {
+        if (compactor.joinable()) compactor.join();
+    }
+
+    // Fold the log into the snapshot and stop logging
+    void closeStorage() {
+        if (!wal) return;
+        compactLog();
+        waitForCompaction();
+        wal.reset();
+        storagePath.clear();
+    }
+
+    // Find the position of an item by its already-lowercased ID, or -1 if not found
+    int findItem(const string &lowerId) const {
+        OperationTimer timer(METRIC_LOOKUP);
+        auto it = idIndex.find(lowerId);
+        return it == idIndex.end() ? -1 : it->second;
+    }
+
+    // Show the registered categories and read a choice. Returns the category code,
+    // CATEGORY_RETURN, CATEGORY_NEW (only offered when allowNew is set) or
+    // CATEGORY_INVALID.
+    int getCategoryChoice(bool allowNew = false) {
+        int count = categories.size();
+        int newOption = allowNew ? count + 1 : -1;
+        int returnOption = allowNew ? count + 2 : count + 1;
+
+        cout << "\n";
+        for (int code = 0; code < count; code++) {
+            cout << code + 1 << " - " << categories.name(code) << "\n";
+        }
+        if (allowNew) cout << newOption << " - Add New Category\n";
+        cout << returnOption << " - Return to Main Menu\n";
+
+        string categoryChoiceInput; // Use a string to read input first
+        cout << "\nEnter Category: ";
+        cin >> categoryChoiceInput; // Read input as string
+
+        // Validate the input before converting to integer
+        if (!isValidInteger(categoryChoiceInput)) {
+            cout << "\nInvalid input! Please enter a number." << endl;
+            clearInput(); // Clear the input buffer
+            return CATEGORY_INVALID;
+        }
+
+        // Convert the valid string input to integer
+        int categoryChoice = stoi(categoryChoiceInput); 
+
+        if (categoryChoice == returnOption) return CATEGORY_RETURN;
+        if (categoryChoice == newOption) return CATEGORY_NEW;
+
+        // Validate the range of categoryChoice
+        if (categoryChoice < 1 || categoryChoice > count) {
+            cout << "\nCategory " << categoryChoice << " does not exist! Please try again.\n";
+            return CATEGORY_INVALID;
+        }
+
+        return categoryChoice - 1; // Return the category code
+    }
+
+    // Print a table of items, pausing after every page; Enter shows the next page, q stops
+    void printItems(const vector<int> &handles, bool reversed = false) {
+        OperationTimer timer(METRIC_DISPLAY);
+        OutputBuffer out;
+        TableRenderer table(out);
+        table.header();
+        size_t total = handles.size();
+        for (size_t k = 0; k < total; k++) {
+            int handle = reversed ? handles[total - 1 - k] : handles[k];
+            table.row(items[handle], items.details(handle));
+            if (pageSize > 0 && (k + 1) % pageSize == 0 && k + 1 < total) {
+                out << "\n-- " << (long long)(k + 1) << " of " << (long long)total
+                    << " items shown. Press Enter for more, or q to stop: ";
+                out.flush();
+                string answer;
+                timer.pause(); // Not counting the wait for the user
+                if (!getline(cin, answer) || answer == "q" || answer == "Q") break;
+                timer.resume();
+            }
+        }
+        out.flush();
+    }
+
+    void addItem() {
+        cout << "\n===================== Add Item =====================\n";
+        int categoryChoice = getCategoryChoice(true);
+        if (categoryChoice == CATEGORY_RETURN || categoryChoice == CATEGORY_INVALID) return;
+        clearInput();
+
+        string category;
+        if (categoryChoice == CATEGORY_NEW) {
+            cout << "Enter New Category Name: ";
+            getline(cin, category);
+            if (category.empty()) {
+                cout << "\nCategory name cannot be empty!\n";
+                return;
+            }
+            int code = registerCategory(category);
+            if (code == -1) {
+                cout << "\nToo many categories! At most " << CategoryDictionary::MAX_CATEGORIES << " can be registered.\n";
+                return;
+            }
+            category = categories.name(code);
+        } else {
+            category = categories.name(categoryChoice);
+        }
+
+        string id, name, quantityInput, priceInput;
+        int quantity;
+        Money price;
+
+        cout << "Enter Item ID: ";
+        getline(cin, id);
+
+        if (findItem(toLowerCase(id)) != -1) {
+            cout << "\nItem ID " << id << " already exists!\n";
+            return;
+        }
+
+        cout << "Enter Item Name: ";
+        getline(cin, name);
+
+        // Validate Item Quantity input (integer)
+        cout << "Enter Item Quantity: ";  
+        while (true) {
+            getline(cin, quantityInput); // Read as string
+
+            if (!isValidInteger(quantityInput)) {  // Invalid input
+                cout << "Invalid input! Please enter a valid integer for quantity: ";
+            } else {
+                quantity = stoi(quantityInput); // Convert to integer
+                if (quantity > 0) {
+                    break; // Valid input, exit loop
+                } else {
+                cout << "Quantity must be greater than 0! Please enter again: ";
+                }
+            }
+        }
+
+        // Validate Item Price input (pesos and centavos)
+        cout << "Enter Item Price: ";
+        while (true) {
+            getline(cin, priceInput); // Read as string
+
+            if (!parseMoney(priceInput, price)) { // Invalid input
+                cout << "Invalid input! Please enter a valid price: ";
+            } else {
+                if (price > 0) {
+                    break; // Valid input, exit loop
+                } else {
+                    cout << "Price must be greater than 0! Please enter again: ";
+                }
+            }
+        }
+
+        // Item kind, and the details that kind needs
+        string kindInput, detailInput;
+        ItemDetails details;
+        cout << "Item Kind (1 - General, 2 - Perishable, 3 - Electronic, 4 - Clothing): ";
+        while (true) {
+            getline(cin, kindInput);
+            if (kindInput == "1" || kindInput == "2" || kindInput == "3" || kindInput == "4") break;
+            cout << "Invalid input! Please enter a number between 1 and 4: ";
+        }
+        if (kindInput == "2") {
+            PerishableDetails perishable;
+            cout << "Enter Expiry Date (YYYY-MM-DD): ";
+            while (true) {
+                getline(cin, detailInput);
+                if (parseDate(detailInput, perishable.expiryDay)) break;
+                cout << "Invalid input! Please enter a date like 2026-11-01: ";
+            }
+            details = perishable;
+        } else if (kindInput == "3" || kindInput == "4") {
+            cout << (kindInput == "3" ? "Enter Serial Number: " : "Enter Size: ");
+            while (true) {
+                getline(cin, detailInput);
+                if (!detailInput.empty()) break;
+                cout << "Invalid input! Please enter a value: ";
+            }
+            if (kindInput == "3") details = ElectronicDetails{detailInput};
+            else details = ClothingDetails{detailInput};
+        }
+
+        addItem(id, name, quantity, price, category, details);
+        cout << "\nItem added successfully!\n";
+    }
+
+    void updateItem() {
+        cout << "\n=================== Update Item ====================\n";
+
+        string id;
+        cout << "Enter Item ID to Update: ";
+        cin >> id;
+        id = toLowerCase(id); // Convert user input to lowercase
+
+        int i = findItem(id);
+        if (i != -1) {
+            int choice;
+            cout << "\nUpdate Information\n1 - Price\n2 - Quantity\n";
+            cout << "\nEnter your choice: ";
+            cin >> choice;
+
+            if (choice == 1) {
+                string newPriceInput;
+                Money newPrice;
+
+                cout << "Enter new Price: ";
+                clearInput();
+                while (true) {
+                getline(cin, newPriceInput);
+
+                    if (parseMoney(newPriceInput, newPrice)) {
+                        if (newPrice > 0) break; // Ensure the price is positive
+                        cout << "Price must be greater than 0! Please enter again: ";
+                    } else {
+                    cout << "Invalid input! Please enter a valid price: ";
+                    }
+                }
+
+                Money oldPrice = items[i].getPrice();
+                updatePrice(id, newPrice);
+
+                cout << "\nPrice of " << items[i].getName() << " is updated from " 
+                    << moneyToString(oldPrice) << " Php to " 
+                    << moneyToString(newPrice) << " Php.\n";
+            
+            } else if (choice == 2) {
+                string newQuantityInput;
+                int newQuantity;
+
+                cout << "Enter new Quantity: ";
+                while (true) {
+                getline(cin, newQuantityInput);
+
+                    if (isValidInteger(newQuantityInput)) {
+                        newQuantity = stoi(newQuantityInput); // Convert to integer
+                        if (newQuantity > 0) break; // Ensure quantity is positive
+                        cout << "Quantity must be greater than 0! Please enter again: ";
+                    } else {
+                        cout << "Invalid input! Please enter a valid quantity: ";
+                    }
+                }
+
+                int oldQuantity = items[i].getQuantity();
+                updateQuantity(id, newQuantity);
+
+                cout << "\nQuantity of " << items[i].getName() << " is updated from " 
+                    << oldQuantity << " to " << newQuantity << ".\n";
+            }
+
+            // Prompt user to go back to the menu
+            cout << "\nPress Enter to go back to the Menu...";
+            clearInput();
+            cin.get(); // Wait for Enter
+            return;
+        }
+        // If item not found
+        cout << "\nItem ID not found!\n";
+        cout << "\nPress Enter to go back to the Menu...";
+        clearInput();
+        cin.get(); // Wait for Enter
+    }
+
+    void removeItem() {
+        cout << "\n==================== Remove Item ====================\n";
+
+        string line;
+        cout << "\nEnter Item ID(s) to Remove (separate several with spaces): ";
+        clearInput();
+        getline(cin, line);
+
+        // Collect the requested IDs, converted to lowercase
+        vector<string> ids;
+        string id;
+        for (size_t pos = 0; pos <= line.size(); pos++) {
+            if (pos == line.size() || isspace((unsigned char)line[pos])) {
+                if (!id.empty()) ids.push_back(toLowerCase(id));
+                id.clear();
+            } else {
+                id += line[pos];
+            }
+        }
+
+        if (ids.size() == 1) {
+            int i = findItem(ids[0]);
+            if (i != -1) {
+                cout << "\nItem " << items[i].getName() << " has been removed from the inventory.\n";
+                removeItem(ids[0]);
+            } else {
+                cout << "\nItem ID not found!\n";
+            }
+        } else if (ids.size() > 1) {
+            int removed = removeItems(ids);
+            cout << "\n" << removed << " of " << ids.size() << " items have been removed from the inventory.\n";
+        } else {
+            cout << "\nItem ID not found!\n";
+        }
+
+        cout << "\nPress Enter to go back to the Menu...";
+        cin.get(); // Wait for user to press Enter
+    }   
+
+    void displayItemsByCategory() {
+        cout << "\n============= Display Items by Category =============\n";
+    
+        int categoryChoice;
+
+        // Loop until valid input is received
+        while (true) {
+            categoryChoice = getCategoryChoice();
+            if (categoryChoice == CATEGORY_RETURN) {
+                return; // Return to main menu
+            }
+            if (categoryChoice != CATEGORY_INVALID) {
+                break; // Valid input, exit loop
+            }
+        }
+
+        const string &category = categories.name(categoryChoice);
+
+        cout << "\nDisplaying Items in Category: " << category << endl;
+        clearInput(); // The pager reads whole lines
+
+        vector<int> found = findItemsByCategory(category);
+        printItems(found);
+
+        if (found.empty()) {
+            cout << "\nNo items found in this category.\n";
+        }
+
+        cout << "\nPress Enter to go back to the Menu...";
+        cin.get(); // Wait for Enter
+    }
+
+    void displayAllItems() {
+        cout << "\n================= Display All Items =================\n";
+        clearInput(); // The pager reads whole lines
+
+        vector<int> live;
+        live.reserve(getItemCount());
+        for (int i = 0; i < items.size(); i++) {
+            if (items.isAlive(i)) live.push_back(i);
+        }
+        printItems(live);
+
+        cout << "\nPress Enter to go back to the Menu...";
+        cin.get();  // Wait for Enter
+    }
+
+    void searchItem() {
+        cout << "\n==================== Search Item ====================\n";
+        cout << "\nSearch by:\n1 - Item ID\n2 - Text in ID or Name\n3 - Price Range\n4 - Quantity Range\n5 - Return to Main Menu\n";
+        cout << "\nEnter your choice: ";
+        string choiceInput;
+        cin >> choiceInput;
+
+        if (choiceInput == "1") {
+            string id;
+            cout << "Enter Item ID: ";
+            cin >> id;
+            id = toLowerCase(id); // Convert input to lowercase for case-insensitive search
+
+            int i = findItem(id);
+            bool found = (i != -1);
+            printItems(found ? vector<int>{i} : vector<int>());
+
+            if (!found) {
+                cout << "\nItem ID not found!\n";
+            }
+
+            cout << "\nPress Enter to go back to the Menu...";
+            clearInput();
+            cin.get();  // Wait for Enter
+            return;
+        }
+        if (choiceInput == "5") return;
+        clearInput(); // The rest reads whole lines
+
+        vector<int> found;
+        if (choiceInput == "2") {
+            string text;
+            cout << "Enter text to search for: ";
+            getline(cin, text);
+
+            // Items matching in either field, in storage order
+            vector<int> byId = findItemsContaining(TEXT_ID, text);
+            vector<int> byName = findItemsContaining(TEXT_NAME, text);
+            set_union(byId.begin(), byId.end(), byName.begin(), byName.end(), back_inserter(found));
+            cout << "\nItems with \"" << text << "\" in their ID or name:\n";
+        } else if (choiceInput == "3" || choiceInput == "4") {
+            bool byPrice = (choiceInput == "3");
+            string lowInput, highInput, category;
+            Money lowPrice = 0, highPrice = 0;
+            int lowQuantity = 0, highQuantity = 0;
+            cout << "Enter lowest " << (byPrice ? "price" : "quantity") << ": ";
+            while (true) {
+                getline(cin, lowInput);
+                if (byPrice ? parseMoney(lowInput, lowPrice) : parseCount(lowInput, lowQuantity)) break;
+                cout << "Invalid input! Please enter a valid " << (byPrice ? "price" : "quantity") << ": ";
+            }
+            cout << "Enter highest " << (byPrice ? "price" : "quantity") << ": ";
+            while (true) {
+                getline(cin, highInput);
+                if (byPrice ? parseMoney(highInput, highPrice) : parseCount(highInput, highQuantity)) break;
+                cout << "Invalid input! Please enter a valid " << (byPrice ? "price" : "quantity") << ": ";
+            }
+            cout << "Enter category (leave blank for all categories): ";
+            getline(cin, category);
+
+            int code = category.empty() ? -1 : categories.find(category);
+            if (!category.empty() && code == -1) {
+                cout << "\nCategory " << category << " does not exist!\n";
+                cout << "\nPress Enter to go back to the Menu...";
+                cin.get();
+                return;
+            }
+            string scope = code == -1 ? "" : " in " + categories.name(code);
+            if (byPrice) {
+                found = findItemsByPrice(lowPrice, highPrice, category);
+                cout << "\nItems priced " << moneyToString(lowPrice) << " to " << moneyToString(highPrice) << " Php" << scope << ":\n";
+            } else {
+                found = findItemsByQuantity(lowQuantity, highQuantity, category);
+                cout << "\nItems with quantity " << lowInput << " to " << highInput << scope << ":\n";
+            }
+        } else {
+            cout << "\nInvalid choice! Please enter a valid number between 1 and 5.\n";
+            cout << "\nPress Enter to go back to the Menu...";
+            cin.get();
+            return;
+        }
+
+        printItems(found);
+        if (found.empty()) {
+            cout << "\nNo items found.\n";
+        }
+
+        cout << "\nPress Enter to go back to the Menu...";
+        cin.get();  // Wait for Enter
+    }
+
+    void sortItems() {
+        string sortChoiceInput, orderChoiceInput;
+        int sortChoice, orderChoice;
+
+        // Sort Menu
+        while (true) {
+            cout << "\n==================== Sort Items ====================\n";
+            cout << "\nSort by:\n1 - Quantity\n2 - Price\n3 - ID\n4 - Name\n5 - Return to Main Menu\n";
+            cout << "\nEnter your choice: ";
+            getline(cin, sortChoiceInput);  // Use getline to read input
+
+            if (!isValidInteger(sortChoiceInput)) {  // Invalid input
+                cout << "\nInvalid input! Please enter a valid integer for sort choice.\n";
+            } else {
+                sortChoice = stoi(sortChoiceInput); // Convert to integer
+                if (sortChoice >= 1 && sortChoice <= 5) {
+                    break; // Valid input, exit loop
+                } else {
+                    cout << "\nInvalid choice! Please enter a valid number between 1 and 5.\n";
+                }
+            }
+        }
+
+        if (sortChoice == 5) {
+            return; // Exit sorting
+    }
+
+        // Sort Order Menu
+        while (true) {
+            cout << "\nSort order:\n1 - Ascending\n2 - Descending\n3 - Return to Main Menu\n";
+            cout << "\nEnter your choice: ";
+            getline(cin, orderChoiceInput);  // Use getline to read input
+
+            if (!isValidInteger(orderChoiceInput)) {  // Invalid input
+            cout << "\nInvalid input! Please enter a valid integer for order choice.\n";
+            } else {
+                orderChoice = stoi(orderChoiceInput); // Convert to integer
+                if (orderChoice >= 1 && orderChoice <= 3) {
+                    break; // Valid input, exit loop
+                } else {
+                    cout << "\nInvalid choice! Please enter a valid number between 1 and 3.\n";
+                }
+            }
+        }
+
+        if (orderChoice == 3) {
+            return; // Exit sorting
+        }
+
+        // Sorting only reorders a cached list of handles; the items stay where they are
+        const vector<int> &view = getSortedView((SortKey)(sortChoice - 1));
+
+        // Displaying sorted items
+        string sortCriteria;
+        switch (sortChoice) {
+            case 1: sortCriteria = "Quantity"; break;
+            case 2: sortCriteria = "Price"; break;
+            case 3: sortCriteria = "ID"; break;
+            case 4: sortCriteria = "Name"; break;
+        }
+    
+        string sortOrder = (orderChoice == 1) ? "Ascending" : "Descending";
+    
+        cout << "\nSorted Items by " << sortCriteria << " (" << sortOrder << "):\n";
+        printItems(view, orderChoice == 2); // Descending walks the view backwards
+
+        cout << "\nPress Enter to go back to the Menu...\n";
+        clearInput(); // To handle the Enter key
+        cin.get(); // Wait for Enter
+    }
+
+    void saveInventory() {
+        cout << "\n=================== Save Inventory ===================\n";
+        string path;
+        cout << "Enter file name: ";
+        cin >> path;
+
+        if (saveSnapshot(path)) {
+            cout << "\n" << getItemCount() << " items saved to " << path << ".\n";
+        } else {
+            cout << "\nCould not write " << path << "!\n";
+        }
+
+        cout << "\nPress Enter to go back to the Menu...";
+        clearInput();
+        cin.get(); // Wait for Enter
+    }
+
+    void loadInventory() {
+        cout << "\n=================== Load Inventory ===================\n";
+        string path, error;
+        cout << "Enter file name: ";
+        cin >> path;
+
+        if (loadSnapshot(path, &error)) {
+            cout << "\n" << getItemCount() << " items loaded from " << path << ".\n";
+        } else {
+            cout << "\nCould not load inventory: " << error << "\n";
+        }
+
+        cout << "\nPress Enter to go back to the Menu...";
+        clearInput();
+        cin.get(); // Wait for Enter
+    }
+
+    void importItemsFromFile() {
+        cout << "\n==================== Import Items ====================\n";
+        string path;
+        cout << "Enter CSV or TSV file name: ";
+        cin >> path;
+
+        ImportReport report;
+        if (!importItems(path, report)) {
+            cout << "\nCould not open " << path << "!\n";
+        } else {
+            cout << "\n" << report.itemsAdded << " of " << report.rowsRead << " rows imported.\n";
+            const size_t shown = 10;
+            for (size_t i = 0; i < report.errors.size() && i < shown; i++) {
+                cout << report.errors[i] << "\n";
+            }
+            if (report.rowsRejected > (long long)shown) {
+                cout << "... and " << report.rowsRejected - shown << " more rejected rows.\n";
+            }
+        }
+
+        cout << "\nPress Enter to go back to the Menu...";
+        clearInput();
+        cin.get(); // Wait for Enter
+    }
+
+    void displayInventoryValue() {
+        cout << "\n================== Inventory Value ==================\n";
+        cout << left << setw(20) << "Category" << setw(20) << "Items" << setw(20) << "Quantity" << "Value (Php)" << endl;
+        long long totalQuantity = 0;
+        for (int code = 0; code < categories.size(); code++) {
+            const CategoryTotals &totals = categories.getTotals(code);
+            cout << left << setw(20) << categories.name(code) << setw(20) << totals.items << setw(20) << totals.quantity
+                 << moneyToString(totals.value) << "\n";
+            totalQuantity += totals.quantity;
+        }
+        cout << left << setw(20) << "Total" << setw(20) << getItemCount() << setw(20) << totalQuantity
+             << moneyToString(totalValue()) << "\n";
+
+        cout << "\nPress Enter to go back to the Menu...";
+        clearInput();
+        cin.get(); // Wait for Enter
+    }
+
+    void setReorderThreshold() {
+        cout << "\n=============== Set Reorder Threshold ===============\n";
+        cout << "\n1 - Category Threshold\n2 - Item Threshold\n3 - Return to Main Menu\n";
+        cout << "\nEnter your choice: ";
+        string choiceInput;
+        cin >> choiceInput;
+
+        string thresholdInput;
+        if (choiceInput == "1") {
+            int categoryChoice = getCategoryChoice();
+            if (categoryChoice == CATEGORY_RETURN || categoryChoice == CATEGORY_INVALID) return;
+            const string &category = categories.name(categoryChoice);
+
+            cout << "Current threshold of " << category << ": " << categories.threshold(categoryChoice) << "\n";
+            cout << "Enter new threshold: ";
+            clearInput();
+            while (true) {
+                getline(cin, thresholdInput);
+                if (isValidInteger(thresholdInput)) break;
+                cout << "Invalid input! Please enter a valid threshold: ";
+            }
+            setCategoryThreshold(category, stoi(thresholdInput));
+            cout << "\nItems in " << category << " are now low on stock at " << stoi(thresholdInput) << " or below.\n";
+        } else if (choiceInput == "2") {
+            string id;
+            cout << "Enter Item ID: ";
+            cin >> id;
+            id = toLowerCase(id);
+            clearInput();
+
+            int i = findItem(id);
+            if (i == -1) {
+                cout << "\nItem ID not found!\n";
+            } else {
+                cout << "Current threshold of " << items[i].getName() << ": " << getReorderThreshold(i)
+                     << (columns.reorderThreshold[i] == -1 ? " (from its category)" : "") << "\n";
+                cout << "Enter new threshold, or 'default' to use the category's: ";
+                while (true) {
+                    getline(cin, thresholdInput);
+                    if (isValidInteger(thresholdInput) || toLowerCase(thresholdInput) == "default") break;
+                    cout << "Invalid input! Please enter a valid threshold: ";
+                }
+                int threshold = isValidInteger(thresholdInput) ? stoi(thresholdInput) : -1;
+                setItemThreshold(id, threshold);
+                cout << "\n" << items[i].getName() << " is now low on stock at " << getReorderThreshold(i) << " or below.\n";
+            }
+        } else if (choiceInput == "3") {
+            return;
+        } else {
+            cout << "\nInvalid choice! Please enter a valid number between 1 and 3.\n";
+            clearInput();
+        }
+
+        cout << "\nPress Enter to go back to the Menu...";
+        cin.get(); // Wait for Enter
+    }
+
+    // Receive or ship several items at once; all of the changes are made or none
+    void recordStockMovement() {
+        cout << "\n================== Stock Movement ===================\n";
+        cout << "Enter one item per line as 'ID change', e.g. 'A1 -3' to ship\n";
+        cout << "3 units or 'B2 +10' to receive 10. Leave a line empty to finish.\n\n";
+        clearInput();
+
+        vector<StockChange> changes;
+        string line;
+        vector<string> words;
+        while (true) {
+            cout << "> ";
+            if (!getline(cin, line)) break;
+            splitCommand(line, words);
+            if (words.empty()) break;
+            int delta;
+            if (words.size() != 2 || !parseDelta(words[1], delta)) {
+                cout << "Invalid input! Please enter an item ID and a change like -3 or +10.\n";
+                continue;
+            }
+            changes.push_back({words[0], delta});
+        }
+
+        string error;
+        if (changes.empty()) {
+            cout << "\nNo changes entered.\n";
+        } else if (applyStockChanges(changes, &error)) {
+            cout << "\nStock updated for " << changes.size() << " line(s).\n";
+        } else {
+            cout << "\nNo changes made: " << error << ".\n";
+        }
+
+        cout << "\nPress Enter to go back to the Menu...";
+        cin.get(); // Wait for Enter
+    }
+
+    void displayLowStockItems() {
+        cout << "\n============== Display Low Stock Items ==============\n";
+        cout << "Displaying Low Stock Items (at or below their reorder threshold):\n";
+        clearInput(); // The pager reads whole lines
+
+        vector<int> found = getLowStockItems();
+        printItems(found);
+
+        if (found.empty()) {
+            cout << "\nNo items at or below their reorder threshold.\n";
+        }
+
+        cout << "\nPress Enter to go back to the Menu...";
+        cin.get(); 
+    }
+};
+
+// Inventory that many threads can use at once. Items are spread over shards
+// by a hash of their lowercase ID. Each shard's ID index is guarded by a
+// reader-writer lock that is only taken exclusively to add or remove items;
+// price and quantity changes take it shared and update the item in place
+// under a per-item seqlock. Readers therefore never wait for price or
+// quantity writers: they read the fields and retry if a writer was active.
+class ConcurrentInventory {
+private:
+    struct Record {
+        string id, name, category; // Never change once the item is added
+        atomic<uint32_t> version{0}; // Seqlock: odd while a writer is changing the fields below
+        atomic<int32_t> quantity{0};
+        atomic<Money> price{0};
+    };
+
+    struct alignas(64) Shard {
+        mutable shared_mutex lock;
+        unordered_map<string, unique_ptr<Record>> index; // Lowercase ID -> item
+    };
+
+    static const int SHARD_COUNT = 64;
+    Shard shards[SHARD_COUNT];
+    atomic<int> itemCount{0};
+
+    mutex categoryLock;
+    CategoryDictionary categories; // Only used for the registered names
+
+    Shard &shardFor(const string &lowerId) { return shards[hash<string>()(lowerId) % SHARD_COUNT]; }
+    const Shard &shardFor(const string &lowerId) const { return shards[hash<string>()(lowerId) % SHARD_COUNT]; }
+
+    // Take a record's seqlock for writing; spins while another writer holds it
+    static uint32_t lockRecord(Record &record) {
+        uint32_t version = record.version.load(memory_order_relaxed);
+        while (true) {
+            if (version % 2 == 0
+                && record.version.compare_exchange_weak(version, version + 1, memory_order_acquire)) {
+                return version + 1;
+            }
+            this_thread::yield();
+            version = record.version.load(memory_order_relaxed);
+        }
+    }
+
+    static void unlockRecord(Record &record, uint32_t lockedVersion) {
+        record.version.store(lockedVersion + 1, memory_order_release);
+    }
+
+    // Consistent copy of a record's fields, retrying while a writer is active
+    static void readRecord(const Record &record, ItemRecord &out) {
+        while (true) {
+            uint32_t before = record.version.load(memory_order_acquire);
+            if (before % 2 == 0) {
+                int32_t quantity = record.quantity.load(memory_order_relaxed);
+                Money price = record.price.load(memory_order_relaxed);
+                atomic_thread_fence(memory_order_acquire);
+                if (record.version.load(memory_order_relaxed) == before) {
+                    out.quantity = quantity;
+                    out.price = price;
+                    break;
+                }
+            }
+            this_thread::yield();
+        }
+        out.id = record.id;
+        out.name = record.name;
+        out.category = record.category;
+    }
+
+    // Run a change on one item's fields under its seqlock; false if the item is not found
+    template <typename F>
+    bool modify(const string &lowerId, F change) {
+        Shard &shard = shardFor(lowerId);
+        shared_lock<shared_mutex> guard(shard.lock);
+        auto it = shard.index.find(lowerId);
+        if (it == shard.index.end()) return false;
+        Record &record = *it->second;
+        uint32_t locked = lockRecord(record);
+        change(record);
+        unlockRecord(record, locked);
+        return true;
+    }
+
+public:
+    ConcurrentInventory() {
+        categories.registerCategory("Clothing");
+        categories.registerCategory("Electronics");
+        categories.registerCategory("Entertainment");
+    }
+
+    int getItemCount() const { return itemCount.load(memory_order_relaxed); }
+
+    // Add an item; returns false if the ID is already taken
+    bool addItem(const string &id, const string &name, int quantity, Money price, const string &category) {
+        string categoryName;
+        {
+            lock_guard<mutex> guard(categoryLock);
+            int code = categories.registerCategory(category);
+            if (code == -1) return false;
+            categoryName = categories.name(code);
+        }
+        unique_ptr<Record> record(new Record);
+        record->id = id;
+        record->name = name;
+        record->category = categoryName;
+        record->quantity.store(quantity, memory_order_relaxed);
+        record->price.store(price, memory_order_relaxed);
+
+        string lowerId = toLowerCase(id);
+        Shard &shard = shardFor(lowerId);
+        unique_lock<shared_mutex> guard(shard.lock);
+        if (!shard.index.emplace(lowerId, std::move(record)).second) return false;
+        itemCount.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    // Remove an item by its already-lowercased ID; returns false if not found
+    bool removeItem(const string &lowerId) {
+        Shard &shard = shardFor(lowerId);
+        unique_lock<shared_mutex> guard(shard.lock);
+        if (shard.index.erase(lowerId) == 0) return false;
+        itemCount.fetch_sub(1, memory_order_relaxed);
+        return true;
+    }
+
+    bool updatePrice(const string &lowerId, Money newPrice) {
+        return modify(lowerId, [&](Record &record) { record.price.store(newPrice, memory_order_relaxed); });
+    }
+
+    bool updateQuantity(const string &lowerId, int newQuantity) {
+        return modify(lowerId, [&](Record &record) { record.quantity.store(newQuantity, memory_order_relaxed); });
+    }
+
+    // Change quantity and price together; readers see both changes or neither
+    bool updateItem(const string &lowerId, int newQuantity, Money newPrice) {
+        return modify(lowerId, [&](Record &record) {
+            record.quantity.store(newQuantity, memory_order_relaxed);
+            record.price.store(newPrice, memory_order_relaxed);
+        });
+    }
+
+    // Apply a stock transaction as a whole, like Inventory::applyStockChanges.
+    // The shards involved are read-locked in index order and then the items'
+    // seqlocks are taken in address order, so concurrent transactions over
+    // overlapping items can't deadlock. Every item stays locked until all of
+    // the changes are in, so readers see the transaction entirely or not at all.
+    bool applyStockChanges(const vector<StockChange> &changes, string *error = nullptr) {
+        vector<string> lowerIds(changes.size());
+        vector<int> shardIndexes;
+        shardIndexes.reserve(changes.size());
+        for (size_t i = 0; i < changes.size(); i++) {
+            lowerIds[i] = toLowerCase(changes[i].id);
+            shardIndexes.push_back(hash<string>()(lowerIds[i]) % SHARD_COUNT);
+        }
+        vector<int> lockedShards = shardIndexes;
+        sort(lockedShards.begin(), lockedShards.end());
+        lockedShards.erase(unique(lockedShards.begin(), lockedShards.end()), lockedShards.end());
+        vector<shared_lock<shared_mutex>> guards;
+        guards.reserve(lockedShards.size());
+        for (int index : lockedShards) guards.emplace_back(shards[index].lock);
+
+        // One lookup per change, then lock each distinct item once
+        vector<pair<Record *, size_t>> lookups; // item, index into changes
+        lookups.reserve(changes.size());
+        for (size_t i = 0; i < changes.size(); i++) {
+            const Shard &shard = shards[shardIndexes[i]];
+            auto it = shard.index.find(lowerIds[i]);
+            if (it == shard.index.end()) {
+                if (error) *error = "item ID " + changes[i].id + " not found";
+                return false;
+            }
+            lookups.emplace_back(it->second.get(), i);
+        }
+        sort(lookups.begin(), lookups.end());
+        vector<pair<Record *, uint32_t>> locked; // item, locked version
+        locked.reserve(lookups.size());
+        for (size_t i = 0; i < lookups.size(); i++) {
+            if (i == 0 || lookups[i].first != lookups[i - 1].first) {
+                locked.emplace_back(lookups[i].first, lockRecord(*lookups[i].first));
+            }
+        }
+
+        // Work out every new quantity before changing any
+        vector<int32_t> quantities;
+        quantities.reserve(locked.size());
+        bool valid = true;
+        for (size_t i = 0; i < lookups.size();) {
+            Record &record = *lookups[i].first;
+            int32_t current = record.quantity.load(memory_order_relaxed);
+            long long quantity = current;
+            size_t first = lookups[i].second;
+            for (; i < lookups.size() && lookups[i].first == &record; i++) {
+                quantity += changes[lookups[i].second].delta;
+            }
+            if (quantity < 0 || quantity > INT32_MAX) {
+                if (error) {
+                    *error = "item ID " + changes[first].id + (quantity < 0 ? " would go below zero" : " would overflow")
+                             + " (has " + to_string(current) + ")";
+                }
+                valid = false;
+                break;
+            }
+            quantities.push_back((int32_t)quantity);
+        }
+        for (size_t l = 0; l < locked.size(); l++) {
+            if (valid) locked[l].first->quantity.store(quantities[l], memory_order_relaxed);
+            unlockRecord(*locked[l].first, locked[l].second);
+        }
+        return valid;
+    }
+
+    // Copy an item by its already-lowercased ID; returns false if not found
+    bool findItem(const string &lowerId, ItemRecord &item) const {
+        const Shard &shard = shardFor(lowerId);
+        shared_lock<shared_mutex> guard(shard.lock);
+        auto it = shard.index.find(lowerId);
+        if (it == shard.index.end()) return false;
+        readRecord(*it->second, item);
+        return true;
+    }
+
+    // Copies of the items in a category (case-insensitive), ordered by ID.
+    // Shards are read one at a time, so items added or removed meanwhile may or may not appear.
+    vector<ItemRecord> findItemsByCategory(const string &category) const {
+        vector<ItemRecord> found;
+        for (const Shard &shard : shards) {
+            shared_lock<shared_mutex> guard(shard.lock);
+            for (const auto &entry : shard.index) {
+                if (compareIgnoreCase(entry.second->category, category) == 0) {
+                    found.emplace_back();
+                    readRecord(*entry.second, found.back());
+                }
+            }
+        }
+        sort(found.begin(), found.end(), [](const ItemRecord &a, const ItemRecord &b) {
+            return compareIgnoreCase(a.id, b.id) < 0;
+        });
+        return found;
+    }
+};
+
+// Stock of one item at one location
+struct LocationStock {
+    int location;
+    int quantity;
+};
+
+// An item as stocked at one location
+struct LocationItem {
+    int location;
+    ItemRecord item;
+};
+
+// Inventory spread over several locations (warehouses, stores). Each location
+// is a shard with an Inventory of its own, so its own ID index, and its own
+// reader-writer lock: changes at different locations never wait for each
+// other. The same ID can be stocked at several locations, each with its own
+// quantity. Questions that scan every location, such as low stock anywhere,
+// run on all shards at once on the thread pool and merge the answers. Lookups
+// of one ID visit the locations in turn on the caller's thread: each costs
+// about as much as handing a task to the pool. Each location is read
+// consistently, but not all of them at the same instant: a transfer made
+// meanwhile may be seen at both ends or at neither.
+class WarehouseNetwork {
+private:
+    struct Location {
+        string name;
+        mutable shared_mutex lock;
+        Inventory inventory;
+    };
+
+    vector<unique_ptr<Location>> locations;
+    unique_ptr<ThreadPool> pool;
+    mutex poolLock; // ThreadPool::run serves one caller at a time; the others work alone
+
+    // Run fn(location) for every location, in parallel if asked and the pool is free
+    void forEachLocation(const function<void(int)> &fn, bool parallel = true) {
+        unique_lock<mutex> usePool(poolLock, defer_lock);
+        if (parallel && pool && usePool.try_lock()) {
+            pool->run((int)locations.size(), fn);
+        } else {
+            for (int location = 0; location < (int)locations.size(); location++) fn(location);
+        }
+    }
+
+    static ItemRecord recordOf(const Inventory &inventory, int handle) {
+        const GeneralItem &item = inventory.getItem(handle);
+        return {string(item.getId()), string(item.getName()), item.getQuantity(), item.getPrice(),
+                string(item.getCategory()), formatDetails(inventory.getDetails(handle))};
+    }
+
+public:
+    // threadCount threads (counting the caller) run the scans of every location
+    explicit WarehouseNetwork(int threadCount = 1) {
+        if (threadCount > 1) pool.reset(new ThreadPool(threadCount));
+    }
+
+    // Add a location, or find it if the name is taken; returns its index.
+    // Locations are set up before the network is shared between threads.
+    int addLocation(const string &name) {
+        int found = findLocation(name);
+        if (found != -1) return found;
+        locations.emplace_back(new Location());
+        locations.back()->name = name;
+        return (int)locations.size() - 1;
+    }
+
+    int findLocation(const string &name) const {
+        for (size_t l = 0; l < locations.size(); l++) {
+            if (compareIgnoreCase(locations[l]->name, name) == 0) return (int)l;
+        }
+        return -1;
+    }
+
+    int getLocationCount() const { return (int)locations.size(); }
+    const string &getLocationName(int location) const { return locations[location]->name; }
+
+    // Take in stock at a location: adds the item there, or adds to its quantity if
+    // the location already stocks the ID. Returns false if the quantity would
+    // overflow or the location has no room for another category.
+    bool receive(int location, const string &id, const string &name, int quantity, Money price, const string &category,
+                 const ItemDetails &details = ItemDetails()) {
+        Location &shard = *locations[location];
+        unique_lock<shared_mutex> hold(shard.lock);
+        string lowerId = toLowerCase(id);
+        int handle = shard.inventory.findItem(lowerId);
+        if (handle == -1) return shard.inventory.addItem(id, name, quantity, price, category, details);
+        long long total = (long long)shard.inventory.getItem(handle).getQuantity() + quantity;
+        if (total > INT32_MAX || total < 0) return false;
+        return shard.inventory.updateQuantity(lowerId, (int)total);
+    }
+
+    // Set an item's quantity at a location; false if the location does not stock it
+    bool setQuantity(int location, const string &id, int quantity) {
+        Location &shard = *locations[location];
+        unique_lock<shared_mutex> hold(shard.lock);
+        return shard.inventory.updateQuantity(toLowerCase(id), quantity);
+    }
+
+    // Move units of an item from one location to another, as a whole: if the
+    // source lacks the item or the units, nothing changes and *error says why.
+    // A destination that does not stock the item yet gets it with the source's
+    // name, price, category and details.
+    bool transfer(const string &id, int from, int to, int quantity, string *error = nullptr) {
+        auto fail = [&](const string &message) {
+            if (error) *error = message;
+            return false;
+        };
+        if (from == to) return fail("source and destination are the same location");
+        if (quantity <= 0) return fail("quantity must be greater than 0");
+        // Lock in index order, so two opposite transfers cannot deadlock
+        Location &source = *locations[from];
+        Location &destination = *locations[to];
+        unique_lock<shared_mutex> first(locations[min(from, to)]->lock);
+        unique_lock<shared_mutex> second(locations[max(from, to)]->lock);
+
+        string lowerId = toLowerCase(id);
+        int handle = source.inventory.findItem(lowerId);
+        if (handle == -1) return fail("item ID " + id + " is not stocked at " + source.name);
+        int available = source.inventory.getItem(handle).getQuantity();
+        if (available < quantity) {
+            return fail("only " + to_string(available) + " of item ID " + id + " at " + source.name);
+        }
+        int target = destination.inventory.findItem(lowerId);
+        if (target != -1 && (long long)destination.inventory.getItem(target).getQuantity() + quantity > INT32_MAX) {
+            return fail("item ID " + id + " would overflow at " + destination.name);
+        }
+        string category(source.inventory.getItem(handle).getCategory());
+        if (target == -1 && !destination.inventory.getCategories().canRegister(category)) {
+            return fail("too many categories at " + destination.name + " to add " + category);
+        }
+
+        source.inventory.updateQuantity(lowerId, available - quantity);
+        if (target == -1) {
+            const GeneralItem &item = source.inventory.getItem(handle);
+            destination.inventory.addItem(string(item.getId()), string(item.getName()), quantity, item.getPrice(),
+                                          string(item.getCategory()), source.inventory.getDetails(handle));
+        } else {
+            destination.inventory.updateQuantity(lowerId, destination.inventory.getItem(target).getQuantity() + quantity);
+        }
+        return true;
+    }
+
+    // Units of an item at one location (0 if it is not stocked there)
+    int quantityAt(int location, const string &id) const {
+        const Location &shard = *locations[location];
+        shared_lock<shared_mutex> hold(shard.lock);
+        int handle = shard.inventory.findItem(toLowerCase(id));
+        return handle == -1 ? 0 : shard.inventory.getItem(handle).getQuantity();
+    }
+
+    // Units of an item at each location that stocks it, in location order
+    vector<LocationStock> availability(const string &id) {
+        string lowerId = toLowerCase(id);
+        vector<int> quantities(locations.size(), -1);
+        forEachLocation([&](int location) {
+            const Location &shard = *locations[location];
+            shared_lock<shared_mutex> hold(shard.lock);
+            int handle = shard.inventory.findItem(lowerId);
+            if (handle != -1) quantities[location] = shard.inventory.getItem(handle).getQuantity();
+        }, false);
+        vector<LocationStock> found;
+        for (size_t l = 0; l < quantities.size(); l++) {
+            if (quantities[l] != -1) found.push_back({(int)l, quantities[l]});
+        }
+        return found;
+    }
+
+    // Units of an item over all locations
+    long long totalAvailable(const string &id) {
+        long long total = 0;
+        for (const LocationStock &stock : availability(id)) total += stock.quantity;
+        return total;
+    }
+
+    // Items at or below their reorder threshold at every location (or, given a
+    // threshold, at or below it), by location and then in storage order
+    vector<LocationItem> lowStockEverywhere(int threshold = -1) {
+        vector<vector<LocationItem>> perLocation(locations.size());
+        forEachLocation([&](int location) {
+            Location &shard = *locations[location];
+            shared_lock<shared_mutex> hold(shard.lock);
+            vector<int> handles = threshold < 0 ? shard.inventory.getLowStockItems()
+                                                : shard.inventory.findLowStockItems(threshold);
+            for (int handle : handles) perLocation[location].push_back({location, recordOf(shard.inventory, handle)});
+        });
+        vector<LocationItem> found;
+        for (vector<LocationItem> &items : perLocation) {
+            move(items.begin(), items.end(), back_inserter(found));
+        }
+        return found;
+    }
+
+    // Total units over all locations, summed from the category totals
+    long long totalUnits() {
+        vector<long long> units(locations.size(), 0);
+        forEachLocation([&](int location) {
+            const Location &shard = *locations[location];
+            shared_lock<shared_mutex> hold(shard.lock);
+            const CategoryDictionary &categories = shard.inventory.getCategories();
+            for (int code = 0; code < categories.size(); code++) units[location] += categories.getTotals(code).quantity;
+        });
+        long long total = 0;
+        for (long long count : units) total += count;
+        return total;
+    }
+};
+
+// Operation counts and latencies since startup, then the item and memory
+// gauges, as a table for people. Latencies come from the timed calls; the
+// total is scaled up to all calls.
+string formatStats(const Inventory &inventory) {
+    string text;
+    char line[160];
+#if INVENTORY_METRICS
+    vector<LatencyHistogram> histograms = Metrics::collect();
+    snprintf(line, sizeof(line), "%-12s %12s %12s %12s %12s %12s\n", "operation", "count", "p50 us", "p99 us", "max us", "total ms");
+    text += line;
+    for (int op = 0; op < METRIC_OPERATION_COUNT; op++) {
+        const LatencyHistogram &histogram = histograms[op];
+        if (histogram.operations == 0) continue;
+        snprintf(line, sizeof(line), "%-12s %12llu %12.2f %12.2f %12.2f %12.2f\n", METRIC_OPERATION_NAMES[op],
+                 (unsigned long long)histogram.operations, histogram.percentile(0.50) / 1e3,
+                 histogram.percentile(0.99) / 1e3, histogram.maxNs / 1e3, histogram.estimatedTotalNs() / 1e6);
+        text += line;
+    }
+#else
+    text += "operation metrics: not built in (INVENTORY_METRICS=0)\n";
+#endif
+    snprintf(line, sizeof(line), "items: %d (%d slots)\nstring arena: %zu bytes\nheap in use: %zu bytes\n",
+             inventory.getItemCount(), inventory.getSlotCount(), inventory.getStringBytes(), heapBytesInUse());
+    text += line;
+    return text;
+}
+
+// The same in the Prometheus text exposition format. Latencies are histograms
+// in seconds whose buckets are summed up from the finer latency histograms.
+string formatPrometheusMetrics(const Inventory &inventory) {
+    string text;
+    char line[512];
+#if INVENTORY_METRICS
+    static const double limits[] = {1e-7, 2.5e-7, 5e-7, 1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4,
+                                    5e-4, 1e-3, 2.5e-3, 5e-3, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+    vector<LatencyHistogram> histograms = Metrics::collect();
+    text += "# HELP inventory_operations_total Inventory operations run, by operation.\n"
+            "# TYPE inventory_operations_total counter\n";
+    for (int op = 0; op < METRIC_OPERATION_COUNT; op++) {
+        snprintf(line, sizeof(line), "inventory_operations_total{operation=\"%s\"} %llu\n", METRIC_OPERATION_NAMES[op],
+                 (unsigned long long)histograms[op].operations);
+        text += line;
+    }
+    text += "# HELP inventory_operation_duration_seconds Time taken by the timed (sampled) inventory operations.\n"
+            "# TYPE inventory_operation_duration_seconds histogram\n";
+    for (int op = 0; op < METRIC_OPERATION_COUNT; op++) {
+        const LatencyHistogram &histogram = histograms[op];
+        const char *name = METRIC_OPERATION_NAMES[op];
+        uint64_t below = 0;
+        int bucket = 0;
+        for (double limit : limits) {
+            for (; bucket < LatencyHistogram::BUCKETS && LatencyHistogram::bucketLimit(bucket) <= (uint64_t)(limit * 1e9); bucket++) {
+                below += histogram.counts[bucket];
+            }
+            snprintf(line, sizeof(line), "inventory_operation_duration_seconds_bucket{operation=\"%s\",le=\"%g\"} %llu\n",
+                     name, limit, (unsigned long long)below);
+            text += line;
+        }
+        snprintf(line, sizeof(line), "inventory_operation_duration_seconds_bucket{operation=\"%s\",le=\"+Inf\"} %llu\n",
+                 name, (unsigned long long)histogram.count);
+        text += line;
+        snprintf(line, sizeof(line), "inventory_operation_duration_seconds_sum{operation=\"%s\"} %.9f\n", name, histogram.totalNs / 1e9);
+        text += line;
+        snprintf(line, sizeof(line), "inventory_operation_duration_seconds_count{operation=\"%s\"} %llu\n", name,
+                 (unsigned long long)histogram.count);
+        text += line;
+    }
+#endif
+    snprintf(line, sizeof(line),
+             "# HELP inventory_items Live items.\n# TYPE inventory_items gauge\ninventory_items %d\n"
+             "# HELP inventory_item_slots Item slots, live items plus removed ones not yet compacted.\n"
+             "# TYPE inventory_item_slots gauge\ninventory_item_slots %d\n",
+             inventory.getItemCount(), inventory.getSlotCount());
+    text += line;
+    snprintf(line, sizeof(line),
+             "# HELP inventory_string_arena_bytes Bytes allocated for item strings.\n"
+             "# TYPE inventory_string_arena_bytes gauge\ninventory_string_arena_bytes %zu\n",
+             inventory.getStringBytes());
+    text += line;
+    snprintf(line, sizeof(line),
+             "# HELP inventory_heap_bytes Heap bytes in use by the process.\n"
+             "# TYPE inventory_heap_bytes gauge\ninventory_heap_bytes %zu\n",
+             heapBytesInUse());
+    text += line;
+    return text;
+}
+
+// Runs text commands against an Inventory without any prompts, for scripting
+// and replaying workloads. One command per line:
+//
+//   add <category> <id> <name> <quantity> <price> [<details>]
+//        (details: expires=YYYY-MM-DD, serial=<serial> or size=<size>)
+//   update-price <id> <price>
+//   update-quantity <id> <quantity>
+//   stock <id> <delta> [<id> <delta> ...]   (all-or-nothing, e.g. stock A1 -3 B2 +10)
+//   remove <id> [<id> ...]
+//   search <id>
+//   sort quantity|price|id|name [asc|desc]
+//   list [<category>]
+//   range price|quantity <low> <high> [<category>]
+//   prefix id|name <text>
+//   contains id|name <text>
+//   kind general|perishable|electronic|clothing
+//   expiring <YYYY-MM-DD>|<days>   (perishables expiring by a date or within N days)
+//   low-stock [<threshold>]    (without a threshold: the reorder watchlist)
+//   threshold category <name> <threshold>
+//   threshold item <id> <threshold>|default
+//   limit <rows>         (most rows each listing prints; 0 = all)
+//   value                (item count, units and stock value per category and in total)
+//   changes              (item changes since the previous "changes")
+//   stats [prometheus]   (operation counts and latencies, item and memory gauges)
+//   snapshot             (keep the items as they are now as a new version)
+//   versions             (the versions kept, with their UTC times)
+//   as-of <version>|<YYYY-MM-DDTHH:MM:SS>   (the items of a version, or as they were at a UTC time)
+//   import <file>
+//   save <file>
+//
+// Blank lines and lines starting with # are ignored. Mutations print nothing
+// on success; problems are reported as "line N: error: ...". Output is
+// buffered and written in large blocks.
+class CommandProcessor {
+private:
+    Inventory &inventory;
+    OutputBuffer &out;
+    TableRenderer table;
+    long long lineNumber = 0;
+    long long errorCount = 0;
+    vector<string> words;
+    unique_ptr<ChangeCursor> changeCursor; // Position of the "changes" command in the change feed
+
+    void error(const string &message) {
+        errorCount++;
+        out << "line " << lineNumber << ": error: " << message << '\n';
+    }
+
+    void printRows(const vector<int> &handles, bool reversed = false) {
+        OperationTimer timer(METRIC_DISPLAY);
+        for (size_t k = 0; k < handles.size(); k++) {
+            int handle = reversed ? handles[handles.size() - 1 - k] : handles[k];
+            table.row(inventory.getItem(handle), inventory.getDetails(handle));
+        }
+        table.finish();
+    }
+
+    bool parseQuantity(const string &text, int &quantity, bool allowZero = false) {
+        if (!parseCount(text, quantity)) {
+            error("invalid quantity '" + text + "'");
+            return false;
+        }
+        if (quantity == 0 && !allowZero) {
+            error("quantity must be greater than 0");
+            return false;
+        }
+        return true;
+    }
+
+    bool parsePrice(const string &text, Money &price) {
+        if (!parseMoney(text, price)) {
+            error("invalid price '" + text + "'");
+            return false;
+        }
+        if (price <= 0) {
+            error("price must be greater than 0");
+            return false;
+        }
+        return true;
+    }
+
+    bool expectArguments(size_t low, size_t high, const char *usage) {
+        size_t given = words.size() - 1;
+        if (given < low || given > high) {
+            error(string("usage: ") + usage);
+            return false;
+        }
+        return true;
+    }
+
+    void add() {
+        if (!expectArguments(5, 6, "add <category> <id> <name> <quantity> <price> [<details>]")) return;
+        int quantity;
+        Money price;
+        ItemDetails details;
+        if (!parseQuantity(words[4], quantity) || !parsePrice(words[5], price)) return;
+        if (words.size() > 6 && !parseDetails(words[6], details)) {
+            error("invalid details '" + words[6] + "' (expected expires=YYYY-MM-DD, serial=<serial> or size=<size>)");
+            return;
+        }
+        if (!inventory.getCategories().canRegister(words[1])) {
+            error("too many categories to add " + words[1]);
+        } else if (!inventory.addItem(words[2], words[3], quantity, price, words[1], details)) {
+            error("item ID " + words[2] + " already exists");
+        }
+    }
+
+    void updatePrice() {
+        if (!expectArguments(2, 2, "update-price <id> <price>")) return;
+        Money price;
+        if (!parsePrice(words[2], price)) return;
+        if (!inventory.updatePrice(toLowerCase(words[1]), price)) error("item ID " + words[1] + " not found");
+    }
+
+    void updateQuantity() {
+        if (!expectArguments(2, 2, "update-quantity <id> <quantity>")) return;
+        int quantity;
+        if (!parseQuantity(words[2], quantity)) return;
+        if (!inventory.updateQuantity(toLowerCase(words[1]), quantity)) error("item ID " + words[1] + " not found");
+    }
+
+    void stock() {
+        if (words.size() < 3 || words.size() % 2 == 0) {
+            error("usage: stock <id> <delta> [<id> <delta> ...]");
+            return;
+        }
+        vector<StockChange> changes;
+        for (size_t i = 1; i < words.size(); i += 2) {
+            int delta;
+            if (!parseDelta(words[i + 1], delta)) {
+                error("invalid stock change '" + words[i + 1] + "'");
+                return;
+            }
+            changes.push_back({words[i], delta});
+        }
+        string reason;
+        if (!inventory.applyStockChanges(changes, &reason)) error(reason + "; no changes made");
+    }
+
+    void remove() {
+        if (!expectArguments(1, SIZE_MAX, "remove <id> [<id> ...]")) return;
+        vector<string> ids;
+        for (size_t i = 1; i < words.size(); i++) ids.push_back(toLowerCase(words[i]));
+        int removed = inventory.removeItems(ids);
+        if (removed < (int)ids.size()) {
+            error(to_string(ids.size() - removed) + " of " + to_string(ids.size()) + " item IDs not found");
+        }
+    }
+
+    void kind() {
+        if (!expectArguments(1, 1, "kind general|perishable|electronic|clothing")) return;
+        static const char *kinds[] = {"general", "perishable", "electronic", "clothing"};
+        for (int k = 0; k < KIND_COUNT; k++) {
+            if (toLowerCase(words[1]) == kinds[k]) {
+                printRows(inventory.findItemsByKind((ItemKind)k));
+                return;
+            }
+        }
+        error("unknown item kind '" + words[1] + "'");
+    }
+
+    void expiring() {
+        if (!expectArguments(1, 1, "expiring <YYYY-MM-DD>|<days>")) return;
+        int32_t lastDay;
+        int days;
+        if (parseDate(words[1], lastDay)) {
+            printRows(inventory.findItemsExpiringBy(lastDay));
+        } else if (isValidInteger(words[1]) && from_chars(words[1].data(), words[1].data() + words[1].size(), days).ec == errc()) {
+            printRows(inventory.findItemsExpiringBy((int32_t)min<long long>(INT32_MAX, (long long)today() + days)));
+        } else {
+            error("invalid date '" + words[1] + "'");
+        }
+    }
+
+    void search() {
+        if (!expectArguments(1, 1, "search <id>")) return;
+        int handle = inventory.findItem(toLowerCase(words[1]));
+        if (handle == -1) {
+            out << "Item ID " << words[1] << " not found\n";
+        } else {
+            printRows({handle});
+        }
+    }
+
+    void sort() {
+        if (!expectArguments(1, 2, "sort quantity|price|id|name [asc|desc]")) return;
+        static const char *keys[] = {"quantity", "price", "id", "name"};
+        int key = -1;
+        for (int k = 0; k < Inventory::SORT_KEY_COUNT; k++) {
+            if (toLowerCase(words[1]) == keys[k]) key = k;
+        }
+        string order = words.size() > 2 ? toLowerCase(words[2]) : "asc";
+        if (key == -1 || (order != "asc" && order != "desc")) {
+            error("usage: sort quantity|price|id|name [asc|desc]");
+            return;
+        }
+        if (inventory.hasVersionStore()) {
+            printSorted(inventory.getVersionStore().snapshot(false), (Inventory::SortKey)key, order == "desc");
+        } else {
+            printRows(inventory.getSortedView((Inventory::SortKey)key), order == "desc");
+        }
+    }
+
+    void list() {
+        if (!expectArguments(0, 1, "list [<category>]")) return;
+        if (words.size() == 1 && inventory.hasVersionStore()) {
+            printVersion(inventory.getVersionStore().snapshot(false)); // Consistent even while others change items
+        } else if (words.size() == 1) {
+            OperationTimer timer(METRIC_DISPLAY);
+            for (int i = 0; i < inventory.getSlotCount(); i++) {
+                if (inventory.isItemLive(i)) table.row(inventory.getItem(i), inventory.getDetails(i));
+            }
+            table.finish();
+        } else if (inventory.getCategories().find(words[1]) == -1) {
+            error("category " + words[1] + " does not exist");
+        } else {
+            printRows(inventory.findItemsByCategory(words[1]));
+        }
+    }
+
+    void range() {
+        if (!expectArguments(3, 4, "range price|quantity <low> <high> [<category>]")) return;
+        string field = toLowerCase(words[1]);
+        string category = words.size() > 4 ? words[4] : "";
+        if (!category.empty() && inventory.getCategories().find(category) == -1) {
+            error("category " + category + " does not exist");
+            return;
+        }
+        if (field == "price") {
+            Money low, high;
+            if (!parseMoney(words[2], low) || !parseMoney(words[3], high)) {
+                error("invalid price range " + words[2] + " to " + words[3]);
+                return;
+            }
+            printRows(inventory.findItemsByPrice(low, high, category));
+        } else if (field == "quantity") {
+            int low, high;
+            if (!parseQuantity(words[2], low, true) || !parseQuantity(words[3], high, true)) return;
+            printRows(inventory.findItemsByQuantity(low, high, category));
+        } else {
+            error("usage: range price|quantity <low> <high> [<category>]");
+        }
+    }
+
+    // prefix/contains id|name <text>
+    void textSearch(bool prefix) {
+        const char *usage = prefix ? "prefix id|name <text>" : "contains id|name <text>";
+        if (!expectArguments(2, 2, usage)) return;
+        string field = toLowerCase(words[1]);
+        if (field != "id" && field != "name") {
+            error(string("usage: ") + usage);
+            return;
+        }
+        Inventory::TextField textField = field == "id" ? Inventory::TEXT_ID : Inventory::TEXT_NAME;
+        printRows(prefix ? inventory.findItemsByPrefix(textField, words[2])
+                         : inventory.findItemsContaining(textField, words[2]));
+    }
+
+    void lowStock() {
+        if (!expectArguments(0, 1, "low-stock [<threshold>]")) return;
+        if (words.size() == 1) {
+            printRows(inventory.getLowStockItems()); // Each item against its own reorder threshold
+            return;
+        }
+        int threshold;
+        if (!parseThreshold(words[1], threshold)) return;
+        printRows(inventory.findLowStockItems(threshold));
+    }
+
+    bool parseThreshold(const string &text, int &threshold) {
+        if (!isValidInteger(text) || from_chars(text.data(), text.data() + text.size(), threshold).ec != errc()) {
+            error("invalid threshold '" + text + "'");
+            return false;
+        }
+        return true;
+    }
+
+    void threshold() {
+        const char *usage = "threshold category <name> <threshold> | threshold item <id> <threshold>|default";
+        if (!expectArguments(3, 3, usage)) return;
+        string kind = toLowerCase(words[1]);
+        int value = -1;
+        if (kind == "category") {
+            if (!parseThreshold(words[3], value)) return;
+            if (!inventory.setCategoryThreshold(words[2], value)) error("category " + words[2] + " does not exist");
+        } else if (kind == "item") {
+            if (toLowerCase(words[3]) != "default" && !parseThreshold(words[3], value)) return;
+            if (!inventory.setItemThreshold(toLowerCase(words[2]), value)) error("item ID " + words[2] + " not found");
+        } else {
+            error(string("usage: ") + usage);
+        }
+    }
+
+    void limit() {
+        if (!expectArguments(1, 1, "limit <rows>")) return;
+        int rows;
+        if (!isValidInteger(words[1]) || from_chars(words[1].data(), words[1].data() + words[1].size(), rows).ec != errc()
+            || rows < 0) {
+            error("invalid row limit '" + words[1] + "'");
+            return;
+        }
+        table.setRowLimit(rows);
+    }
+
+    void value() {
+        if (!expectArguments(0, 0, "value")) return;
+        const CategoryDictionary &categories = inventory.getCategories();
+        char text[24];
+        long long quantity = 0;
+        for (int code = 0; code < categories.size(); code++) {
+            const CategoryTotals &totals = categories.getTotals(code);
+            out << categories.name(code) << ": " << totals.items << " items, " << totals.quantity << " units, "
+                << string_view(text, formatMoney(text, totals.value) - text) << '\n';
+            quantity += totals.quantity;
+        }
+        out << "Total: " << (long long)inventory.getItemCount() << " items, " << quantity << " units, "
+            << string_view(text, formatMoney(text, inventory.totalValue()) - text) << '\n';
+    }
+
+    // Item changes since the previous "changes"; the first call starts the feed
+    // (or, when it already runs, lists the oldest changes it still holds)
+    void changes() {
+        if (!expectArguments(0, 0, "changes")) return;
+        if (!changeCursor) changeCursor.reset(new ChangeCursor(inventory.getChangeFeed(), true));
+        uint64_t missedBefore = changeCursor->getMissed();
+        ChangeEvent event;
+        char oldText[32], newText[32];
+        while (changeCursor->next(event)) {
+            static const char *types[] = {"add", "update", "remove"};
+            out << '#' << (long long)event.sequence << ' ' << types[event.type] << ' ' << event.getId();
+            string_view oldPrice(oldText, formatMoney(oldText, event.oldPrice) - oldText);
+            string_view newPrice(newText, formatMoney(newText, event.newPrice) - newText);
+            if (event.type == CHANGE_ADD) {
+                out << ": quantity " << event.newQuantity << ", price " << newPrice;
+            } else if (event.type == CHANGE_UPDATE && event.oldPrice != event.newPrice) {
+                out << ": price " << oldPrice << " -> " << newPrice;
+            } else if (event.type == CHANGE_UPDATE) {
+                out << ": quantity " << event.oldQuantity << " -> " << event.newQuantity;
+            }
+            out << '\n';
+        }
+        if (changeCursor->getMissed() > missedBefore) {
+            out << (long long)(changeCursor->getMissed() - missedBefore) << " changes were overwritten before they were read\n";
+        }
+    }
+
+    void printVersion(const VersionedStore::Snapshot &snapshot) {
+        OperationTimer timer(METRIC_DISPLAY);
+        snapshot.forEachItem([this](const VersionedStore::Row &row) {
+            table.row(row.getId(), row.getName(), row.quantity, row.price, row.category, row.getDetails());
+        });
+        table.finish();
+    }
+
+    // A version's items in sort key order, ties broken by ID (unique ignoring
+    // case), so descending order is exactly the reverse of ascending
+    void printSorted(const VersionedStore::Snapshot &snapshot, Inventory::SortKey key, bool reversed) {
+        vector<const VersionedStore::Row *> rows;
+        {
+            OperationTimer timer(METRIC_SORT);
+            snapshot.forEachItem([&rows](const VersionedStore::Row &row) { rows.push_back(&row); });
+            std::sort(rows.begin(), rows.end(), [key](const VersionedStore::Row *a, const VersionedStore::Row *b) {
+                int cmp = 0;
+                switch (key) {
+                    case Inventory::SORT_QUANTITY: cmp = (a->quantity > b->quantity) - (a->quantity < b->quantity); break;
+                    case Inventory::SORT_PRICE: cmp = (a->price > b->price) - (a->price < b->price); break;
+                    case Inventory::SORT_NAME: cmp = compareIgnoreCase(a->getName(), b->getName()); break;
+                    default: break;
+                }
+                return (cmp != 0 ? cmp : compareIgnoreCase(a->getId(), b->getId())) < 0;
+            });
+            if (reversed) reverse(rows.begin(), rows.end());
+        }
+        OperationTimer timer(METRIC_DISPLAY);
+        for (const VersionedStore::Row *row : rows) {
+            table.row(row->getId(), row->getName(), row->quantity, row->price, row->category, row->getDetails());
+        }
+        table.finish();
+    }
+
+    static int64_t toSeconds(VersionedStore::Clock::time_point time) {
+        return chrono::duration_cast<chrono::seconds>(time.time_since_epoch()).count();
+    }
+
+    // Keep the items as they are now as a new version; the first call starts versioning
+    void snapshot() {
+        if (!expectArguments(0, 0, "snapshot")) return;
+        VersionedStore::Snapshot version = inventory.getVersionStore().snapshot();
+        out << "version " << (long long)version.getVersion() << " at " << formatTime(toSeconds(version.getTime())) << '\n';
+    }
+
+    void versions() {
+        if (!expectArguments(0, 0, "versions")) return;
+        for (const VersionedStore::VersionInfo &version : inventory.getVersionStore().versions()) {
+            out << "version " << (long long)version.number << " at " << formatTime(toSeconds(version.time)) << '\n';
+        }
+    }
+
+    // The items of a kept version, or as they were at a (UTC) time
+    void asOf() {
+        if (!expectArguments(1, 1, "as-of <version>|<YYYY-MM-DDTHH:MM:SS>")) return;
+        VersionedStore &store = inventory.getVersionStore();
+        VersionedStore::Snapshot version;
+        uint64_t number;
+        int64_t seconds;
+        if (isValidInteger(words[1])) {
+            if (from_chars(words[1].data(), words[1].data() + words[1].size(), number).ec == errc()) version = store.version(number);
+        } else if (parseTime(words[1], seconds)) {
+            version = store.asOf(VersionedStore::Clock::time_point(chrono::seconds(seconds + 1)) - chrono::nanoseconds(1));
+        } else {
+            error("invalid version or time '" + words[1] + "'");
+            return;
+        }
+        if (!version.valid()) {
+            error("no version of the items is kept for " + words[1]);
+            return;
+        }
+        out << "version " << (long long)version.getVersion() << " at " << formatTime(toSeconds(version.getTime())) << '\n';
+        printVersion(version);
+    }
+
+    void stats() {
+        if (!expectArguments(0, 1, "stats [prometheus]")) return;
+        if (words.size() == 1) {
+            out << formatStats(inventory);
+        } else if (toLowerCase(words[1]) == "prometheus") {
+            out << formatPrometheusMetrics(inventory);
+        } else {
+            error("usage: stats [prometheus]");
+        }
+    }
+
+    void import() {
+        if (!expectArguments(1, 1, "import <file>")) return;
+        ImportReport report;
+        if (!inventory.importItems(words[1], report)) {
+            error("cannot open " + words[1]);
+            return;
+        }
+        out << report.itemsAdded << " of " << report.rowsRead << " rows imported from " << words[1] << '\n';
+        for (const string &message : report.errors) out << words[1] << ": " << message << '\n';
+    }
+
+    void save() {
+        if (!expectArguments(1, 1, "save <file>")) return;
+        if (!inventory.saveSnapshot(words[1])) error("cannot write " + words[1]);
+    }
+
+public:
+    CommandProcessor(Inventory &target, OutputBuffer &output) : inventory(target), out(output), table(output) {}
+
+    long long getErrorCount() const { return errorCount; }
+
+    // Run one command line
+    void execute(const string &line) {
+        lineNumber++;
+        splitCommand(line, words);
+        if (words.empty() || words[0][0] == '#') return;
+
+        const string &command = words[0];
+        bool changesItems = command == "add" || command == "update-price" || command == "update-quantity"
+            || command == "stock" || command == "remove" || command == "threshold" || command == "import";
+        if (changesItems && inventory.hasStorageFailed()) {
+            error("the write-ahead log has failed; changes can no longer be saved");
+            return;
+        }
+        if (command == "add") add();
+        else if (command == "update-price") updatePrice();
+        else if (command == "update-quantity") updateQuantity();
+        else if (command == "stock") stock();
+        else if (command == "remove") remove();
+        else if (command == "search") search();
+        else if (command == "sort") sort();
+        else if (command == "list") list();
+        else if (command == "low-stock") lowStock();
+        else if (command == "range") range();
+        else if (command == "prefix") textSearch(true);
+        else if (command == "contains") textSearch(false);
+        else if (command == "kind") kind();
+        else if (command == "expiring") expiring();
+        else if (command == "limit") limit();
+        else if (command == "value") value();
+        else if (command == "changes") changes();
+        else if (command == "stats") stats();
+        else if (command == "snapshot") snapshot();
+        else if (command == "versions") versions();
+        else if (command == "as-of") asOf();
+        else if (command == "threshold") threshold();
+        else if (command == "import") import();
+        else if (command == "save") save();
+        else error("unknown command '" + command + "'");
+        if (changesItems && inventory.hasStorageFailed()) {
+            error("the change could not be written to the write-ahead log and is not saved");
+        }
+    }
+
+    // Run every command from a stream
+    void run(istream &in) {
+        string line;
+        while (getline(in, line)) execute(line);
+        out.flush();
+    }
+};
+
+// Settings of the synthetic workload used by the benchmark suite
+struct WorkloadConfig {
+    int items = 100000;       // Items in the generated inventory
+    int categories = 16;
+    double skew = 1.0;        // Zipf exponent of category sizes; 0 spreads items evenly
+    int operations = 100000;  // Timed searches, updates and removals
+    uint32_t seed = 1;
+    int threads = 1;
+};
+
+// Generates synthetic items: IDs SKU-0, SKU-1, ..., names built from a small
+// vocabulary, quantities 0..200, prices 1.00..5000.00 and categories drawn with
+// Zipf skew, so category 0 is the largest. The same seed gives the same items.
+class WorkloadGenerator {
+private:
+    WorkloadConfig config;
+    mt19937 rng;
+    discrete_distribution<int> categoryDistribution;
+
+public:
+    explicit WorkloadGenerator(const WorkloadConfig &settings) : config(settings), rng(settings.seed) {
+        vector<double> weights(max(1, config.categories));
+        for (size_t k = 0; k < weights.size(); k++) weights[k] = 1.0 / pow((double)(k + 1), config.skew);
+        categoryDistribution = discrete_distribution<int>(weights.begin(), weights.end());
+    }
+
+    static string categoryName(int k) { return "Category-" + to_string(k); }
+    static string lowerIdOf(int i) { return "sku-" + to_string(i); }
+
+    int randomCategory() { return categoryDistribution(rng); }
+    int randomItem() { return (int)(rng() % (uint32_t)config.items); }
+    uint32_t random() { return rng(); }
+
+    ItemRecord item(int i) {
+        static const char *adjectives[] = {"Red", "Large", "Organic", "Wireless", "Classic", "Compact", "Deluxe", "Slim"};
+        static const char *nouns[] = {"Shirt", "Charger", "Apples", "Headphones", "Lamp", "Notebook", "Sneakers", "Kettle"};
+        ItemRecord record;
+        record.id = "SKU-" + to_string(i);
+        record.name = string(adjectives[rng() % 8]) + " " + nouns[rng() % 8] + " " + to_string(rng() % 1000);
+        record.quantity = (int)(rng() % 201);
+        record.price = 100 + (Money)(rng() % 500000);
+        record.category = categoryName(randomCategory());
+        return record;
+    }
+};
+
+// Benchmark suite: builds a synthetic inventory and times the core operations
+// one call at a time. Prints one JSON document with the configuration, then
+// per operation the count, throughput and p50/p99/max latency, and the peak
+// resident set size, so runs can be compared by script.
+void runBenchmarkSuite(const WorkloadConfig &config) {
+    WorkloadGenerator generator(config);
+    Inventory inventory;
+    inventory.setThreadCount(config.threads);
+    vector<long long> latencies; // Nanoseconds per call of the current step
+    string results;
+
+    // Time count calls of op(i) and add the step's summary to results
+    auto measure = [&](const char *operation, int count, const function<void(int)> &op) {
+        latencies.assign(count, 0);
+        auto begin = chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            auto start = chrono::steady_clock::now();
+            op(i);
+            latencies[i] = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        auto percentile = [&](double fraction) {
+            if (count == 0) return 0LL;
+            size_t rank = min((size_t)count - 1, (size_t)(fraction * count));
+            nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+            return latencies[rank];
+        };
+        long long p50 = percentile(0.50), p99 = percentile(0.99);
+        long long worst = count ? *max_element(latencies.begin(), latencies.end()) : 0;
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "%s    {\"operation\": \"%s\", \"count\": %d, \"ops_per_sec\": %.1f, "
+                 "\"p50_ns\": %lld, \"p99_ns\": %lld, \"max_ns\": %lld}",
+                 results.empty() ? "" : ",\n", operation, count, seconds > 0 ? count / seconds : 0.0, p50, p99, worst);
+        results += line;
+    };
+
+    int n = config.items, ops = config.operations;
+    vector<ItemRecord> records(n);
+    for (int i = 0; i < n; i++) records[i] = generator.item(i);
+    inventory.reserve(n);
+    measure("add", n, [&](int i) {
+        const ItemRecord &record = records[i];
+        inventory.addItem(record.id, record.name, record.quantity, record.price, record.category);
+    });
+    records = vector<ItemRecord>();
+
+    vector<string> ids(ops);
+    for (string &id : ids) id = WorkloadGenerator::lowerIdOf(generator.randomItem());
+    long long found = 0;
+    measure("search", ops, [&](int i) { found += inventory.findItem(ids[i]) != -1; });
+    measure("update", ops, [&](int i) {
+        if (i % 2 == 0) inventory.updateQuantity(ids[i], (int)(generator.random() % 201));
+        else inventory.updatePrice(ids[i], 100 + (Money)(generator.random() % 500000));
+    });
+
+    int sortRuns = 10;
+    measure("sort_quantity", sortRuns, [&](int) {
+        inventory.clearSortedViews();
+        inventory.getSortedView(Inventory::SORT_QUANTITY);
+    });
+    measure("sort_price", sortRuns, [&](int) {
+        inventory.clearSortedViews();
+        inventory.getSortedView(Inventory::SORT_PRICE);
+    });
+    inventory.clearSortedViews(); // Later steps shouldn't pay for keeping views in order
+
+    int listingRuns = 1000;
+    vector<string> listed(listingRuns);
+    for (string &category : listed) category = WorkloadGenerator::categoryName(generator.randomCategory());
+    measure("category_listing", listingRuns, [&](int i) { found += inventory.findItemsByCategory(listed[i]).size(); });
+    measure("low_stock", listingRuns, [&](int) { found += inventory.getLowStockItems().size(); });
+
+    vector<string> removals;
+    for (int i = 0; i < n && (int)removals.size() < min(ops, n / 2); i += 2) {
+        removals.push_back(WorkloadGenerator::lowerIdOf(i));
+    }
+    shuffle(removals.begin(), removals.end(), mt19937(config.seed));
+    measure("remove", (int)removals.size(), [&](int i) { inventory.removeItem(removals[i]); });
+
+    // Latencies include reading the clock once; report what that costs here
+    vector<long long> clockReads(1001);
+    for (long long &cost : clockReads) {
+        auto start = chrono::steady_clock::now();
+        cost = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    }
+    nth_element(clockReads.begin(), clockReads.begin() + 500, clockReads.end());
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cout << "{\n"
+         << "  \"config\": {\"items\": " << config.items << ", \"categories\": " << config.categories
+         << ", \"skew\": " << config.skew << ", \"operations\": " << config.operations
+         << ", \"seed\": " << config.seed << ", \"threads\": " << config.threads << "},\n"
+         << "  \"results\": [\n" << results << "\n  ],\n"
+         << "  \"timer_overhead_ns\": " << clockReads[500] << ",\n"
+         << "  \"peak_rss_kb\": " << usage.ru_maxrss << ",\n"
+         << "  \"checksum\": " << found << "\n"
+         << "}" << endl;
+}
+
+// Open a socket for a server address: a Unix socket path (anything with a '/'),
+// or [host:]port for TCP, where the host defaults to 127.0.0.1. A listening
+// socket is bound (replacing a stale Unix socket file); otherwise it connects.
+// Returns the descriptor, or -1 with a message in error.
+int openSocket(const string &address, bool listening, string *error) {
+    auto fail = [&](const string &message) {
+        if (error) *error = message + ": " + strerror(errno);
+        return -1;
+    };
+    sockaddr_storage storage = {};
+    socklen_t length;
+    if (address.find('/') != string::npos) {
+        sockaddr_un *unixAddress = (sockaddr_un *)&storage;
+        if (address.size() >= sizeof(unixAddress->sun_path)) {
+            errno = ENAMETOOLONG;
+            return fail(address);
+        }
+        unixAddress->sun_family = AF_UNIX;
+        memcpy(unixAddress->sun_path, address.data(), address.size());
+        length = sizeof(sockaddr_un);
+        if (listening) ::unlink(address.c_str());
+    } else {
+        size_t colon = address.rfind(':');
+        string host = colon == string::npos ? "127.0.0.1" : address.substr(0, colon);
+        string port = colon == string::npos ? address : address.substr(colon + 1);
+        sockaddr_in *tcpAddress = (sockaddr_in *)&storage;
+        tcpAddress->sin_family = AF_INET;
+        uint16_t portNumber;
+        if (!isValidInteger(port) || from_chars(port.data(), port.data() + port.size(), portNumber).ec != errc()) {
+            errno = EINVAL;
+            return fail("bad port '" + port + "'");
+        }
+        if (inet_pton(AF_INET, host.empty() ? "127.0.0.1" : host.c_str(), &tcpAddress->sin_addr) != 1) {
+            errno = EINVAL;
+            return fail("bad address '" + address + "'");
+        }
+        tcpAddress->sin_port = htons(portNumber);
+        length = sizeof(sockaddr_in);
+    }
+    int fd = ::socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return fail("socket");
+    int on = 1;
+    if (storage.ss_family == AF_INET) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // Small responses go out at once
+        if (listening) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+    bool opened = listening ? ::bind(fd, (sockaddr *)&storage, length) == 0 && ::listen(fd, 128) == 0
+                            : ::connect(fd, (sockaddr *)&storage, length) == 0;
+    if (!opened) {
+        int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return fail(address);
+    }
+    return fd;
+}
+
+// Serves an Inventory over a socket. Each request is one batch command line
+// (see CommandProcessor), ended by '\n'. Each response is a header line,
+// "OK <length>" or "ERR <length>", then <length> bytes of the command's output.
+// Clients may pipeline: send many requests before reading, and the responses
+// come back in request order.
+//
+// One thread runs an epoll loop that accepts connections, reads requests and
+// writes what the workers could not. A connection with requests waiting is
+// queued for the worker threads; one worker at a time runs its requests, in
+// order, so connections are served in parallel and each stays in order.
+// Commands that only read take the inventory lock shared, the rest exclusive.
+class InventoryServer {
+private:
+    static constexpr size_t MAX_REQUEST_SIZE = 1 << 16;
+    static constexpr size_t MAX_QUEUED_REQUESTS = 1024; // Stop reading a connection past these...
+    static constexpr size_t MAX_QUEUED_OUTPUT = 1 << 20; // ...until its worker or client catches up
+
+    struct Connection {
+        int fd;
+        string input;            // Bytes read after the last whole request (event loop only)
+        mutex lock;              // Guards the fields below
+        deque<string> requests;  // Whole requests waiting for a worker
+        string output;           // Responses not yet written
+        uint32_t events = EPOLLIN;
+        bool scheduled = false;  // Queued for or held by a worker
+        bool inputClosed = false;
+        bool hungUp = false;     // Client closed both ways: no longer watched, nothing can be written
+        bool closed = false;
+        OutputBuffer buffer{-1}; // Collects one command's output (worker only)
+        CommandProcessor processor;
+
+        Connection(int socket, Inventory &inventory) : fd(socket), processor(inventory, buffer) {}
+        ~Connection() { ::close(fd); } // Only when no worker holds it, so the fd is not reused early
+    };
+
+    Inventory &inventory;
+    shared_mutex inventoryLock;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1; // eventfd: stop() and workers finishing a closing connection
+    unordered_map<int, shared_ptr<Connection>> connections; // By fd; event loop only
+    atomic<bool> stopRequested{false};
+
+    mutex queueLock;
+    condition_variable queueReady;
+    deque<shared_ptr<Connection>> ready;       // Connections with requests for a worker
+    vector<shared_ptr<Connection>> finished;   // Idle connections whose client stopped sending
+    bool stopping = false;
+    vector<thread> workers;
+
+    enum LockMode { LOCK_NONE, LOCK_SHARED, LOCK_EXCLUSIVE };
+
+    // Reads take the inventory lock shared; the full listing, sort and the
+    // version commands only use the version store, which has a lock of its own
+    static LockMode lockFor(const string &request) {
+        size_t begin = request.find_first_not_of(" \t");
+        if (begin == string::npos) return LOCK_SHARED;
+        size_t end = request.find_first_of(" \t", begin);
+        string_view command = string_view(request).substr(begin, end == string::npos ? string::npos : end - begin);
+        bool noArguments = end == string::npos || request.find_first_not_of(" \t\r", end) == string::npos;
+        if ((command == "list" && noArguments) || command == "sort" || command == "snapshot" || command == "versions"
+            || command == "as-of") {
+            return LOCK_NONE;
+        }
+        if (command == "search" || command == "list" || command == "low-stock" || command == "kind"
+            || command == "expiring" || command == "value" || command == "limit" || command == "changes"
+            || command == "stats" || command[0] == '#') {
+            return LOCK_SHARED;
+        }
+        return LOCK_EXCLUSIVE;
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t n = ::write(wakeFd, &one, sizeof(one));
+        (void)n;
+    }
+
+    // Write as much queued output as the socket takes. Caller holds c.lock.
+    void writeOutput(Connection &c) {
+        size_t written = 0;
+        while (written < c.output.size()) {
+            ssize_t n = ::send(c.fd, c.output.data() + written, c.output.size() - written, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno == EAGAIN) break; // Full; the event loop writes the rest
+            if (n <= 0) {
+                c.output.clear(); // Client gone
+                c.inputClosed = true;
+                return;
+            }
+            written += (size_t)n;
+        }
+        c.output.erase(0, written);
+    }
+
+    // Watch for reads while there is room for more requests, and for writes while
+    // output waits. Caller holds c.lock.
+    void updateEvents(Connection &c) {
+        uint32_t events = 0;
+        if (!c.inputClosed && c.requests.size() < MAX_QUEUED_REQUESTS && c.output.size() < MAX_QUEUED_OUTPUT) events |= EPOLLIN;
+        if (!c.output.empty()) events |= EPOLLOUT;
+        if (events == c.events || c.hungUp || c.closed) return;
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = c.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, c.fd, &event);
+        c.events = events;
+    }
+
+    static bool isDone(const Connection &c) {
+        return c.inputClosed && !c.scheduled && c.requests.empty() && c.output.empty();
+    }
+
+    void closeConnection(const shared_ptr<Connection> &c) {
+        {
+            lock_guard<mutex> hold(c->lock);
+            if (c->closed) return;
+            c->closed = true;
+        }
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, c->fd, nullptr);
+        connections.erase(c->fd);
+    }
+
+    // Run one request and append its response
+    void execute(Connection &c, const string &request, string &responses) {
+        long long errors = c.processor.getErrorCount();
+        LockMode mode = lockFor(request);
+        if (mode == LOCK_NONE) {
+            c.processor.execute(request);
+        } else if (mode == LOCK_SHARED) {
+            shared_lock<shared_mutex> hold(inventoryLock);
+            c.processor.execute(request);
+        } else {
+            unique_lock<shared_mutex> hold(inventoryLock);
+            c.processor.execute(request);
+        }
+        string &text = c.buffer.contents();
+        responses += c.processor.getErrorCount() == errors ? "OK " : "ERR ";
+        responses += to_string(text.size());
+        responses += '\n';
+        responses += text;
+        text.clear();
+    }
+
+    // Worker: run the requests of one connection until none are left
+    void serve(const shared_ptr<Connection> &c) {
+        deque<string> batch;
+        string responses;
+        while (true) {
+            {
+                lock_guard<mutex> hold(c->lock);
+                if (!responses.empty()) {
+                    c->output += responses;
+                    writeOutput(*c);
+                }
+                if (c->requests.empty()) {
+                    c->scheduled = false;
+                    updateEvents(*c);
+                    if (isDone(*c) && !c->closed) {
+                        lock_guard<mutex> holdQueue(queueLock);
+                        finished.push_back(c);
+                        wake();
+                    }
+                    return;
+                }
+                batch.swap(c->requests);
+                updateEvents(*c); // Room for more requests again
+            }
+            responses.clear();
+            for (const string &request : batch) {
+                if (stopRequested) return; // Shutting down: drop what is left
+                execute(*c, request, responses);
+            }
+            batch.clear();
+        }
+    }
+
+    void workerLoop() {
+        while (true) {
+            shared_ptr<Connection> c;
+            {
+                unique_lock<mutex> hold(queueLock);
+                queueReady.wait(hold, [&] { return stopping || !ready.empty(); });
+                if (stopping) return;
+                c = move(ready.front());
+                ready.pop_front();
+            }
+            serve(c);
+        }
+    }
+
+    void acceptConnections() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                return; // EAGAIN: none left (or out of descriptors; try again on the next event)
+            }
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // Fails harmlessly on Unix sockets
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                ::close(fd);
+                continue;
+            }
+            connections[fd] = make_shared<Connection>(fd, inventory);
+        }
+    }
+
+    // Read what the client sent and queue its whole requests
+    void readRequests(const shared_ptr<Connection> &c) {
+        char chunk[1 << 16];
+        bool closedByClient = false;
+        while (true) {
+            ssize_t n = ::read(c->fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n <= 0) {
+                closedByClient = true;
+                break;
+            }
+            c->input.append(chunk, (size_t)n);
+            if ((size_t)n < sizeof(chunk)) break;
+        }
+        deque<string> requests;
+        size_t begin = 0, end;
+        while ((end = c->input.find('\n', begin)) != string::npos) {
+            size_t length = end - begin;
+            if (length > 0 && c->input[end - 1] == '\r') length--;
+            requests.emplace_back(c->input, begin, length);
+            begin = end + 1;
+        }
+        c->input.erase(0, begin);
+        if (c->input.size() > MAX_REQUEST_SIZE) {
+            closeConnection(c); // Not a command line
+            return;
+        }
+
+        bool done;
+        {
+            lock_guard<mutex> hold(c->lock);
+            for (string &request : requests) c->requests.push_back(move(request));
+            if (closedByClient) c->inputClosed = true;
+            if (!c->scheduled && !c->requests.empty()) {
+                c->scheduled = true;
+                lock_guard<mutex> holdQueue(queueLock);
+                ready.push_back(c);
+                queueReady.notify_one();
+            }
+            updateEvents(*c);
+            done = isDone(*c);
+        }
+        if (done) closeConnection(c);
+    }
+
+    // The client closed its end: run what it sent, stop watching the socket and
+    // drop the responses. The connection closes when its worker is done.
+    void hangUp(const shared_ptr<Connection> &c) {
+        readRequests(c);
+        if (c->closed) return;
+        bool done;
+        {
+            lock_guard<mutex> hold(c->lock);
+            c->inputClosed = c->hungUp = true;
+            c->output.clear();
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, c->fd, nullptr);
+            done = isDone(*c);
+        }
+        if (done) closeConnection(c);
+    }
+
+    void writeReady(const shared_ptr<Connection> &c) {
+        bool done;
+        {
+            lock_guard<mutex> hold(c->lock);
+            writeOutput(*c);
+            updateEvents(*c);
+            done = isDone(*c);
+        }
+        if (done) closeConnection(c);
+    }
+
+public:
+    explicit InventoryServer(Inventory &target) : inventory(target) {}
+    InventoryServer(const InventoryServer &) = delete;
+    InventoryServer &operator=(const InventoryServer &) = delete;
+
+    ~InventoryServer() {
+        if (listenFd >= 0) ::close(listenFd);
+        if (epollFd >= 0) ::close(epollFd);
+        if (wakeFd >= 0) ::close(wakeFd);
+    }
+
+    // Bind the address (see openSocket); returns false with a message in error
+    bool listen(const string &address, string *error = nullptr) {
+        listenFd = openSocket(address, true, error);
+        if (listenFd < 0) return false;
+        fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd < 0 || wakeFd < 0) {
+            if (error) *error = string("epoll: ") + strerror(errno);
+            return false;
+        }
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = listenFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+        event.data.fd = wakeFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+        return true;
+    }
+
+    // Make run() return; callable from any thread or a signal handler
+    void stop() {
+        stopRequested = true;
+        wake();
+    }
+
+    // Serve with workerCount worker threads until stop()
+    void run(int workerCount) {
+        for (int w = 0; w < max(1, workerCount); w++) workers.emplace_back([this] { workerLoop(); });
+        epoll_event events[64];
+        while (!stopRequested) {
+            int count = epoll_wait(epollFd, events, 64, -1);
+            if (count < 0 && errno != EINTR) break;
+            for (int e = 0; e < count; e++) {
+                int fd = events[e].data.fd;
+                if (fd == listenFd) {
+                    acceptConnections();
+                } else if (fd == wakeFd) {
+                    uint64_t value;
+                    ssize_t n = ::read(wakeFd, &value, sizeof(value));
+                    (void)n;
+                    vector<shared_ptr<Connection>> closing;
+                    {
+                        lock_guard<mutex> hold(queueLock);
+                        closing.swap(finished);
+                    }
+                    for (const shared_ptr<Connection> &c : closing) closeConnection(c);
                 } else {
-                    cout << "\nInvalid choice! Please enter a valid number between 1 and 3.\n";
+                    auto found = connections.find(fd);
+                    if (found == connections.end()) continue;
+                    shared_ptr<Connection> c = found->second;
+                    if (events[e].events & (EPOLLERR | EPOLLHUP)) {
+                        hangUp(c);
+                    } else {
+                        if (events[e].events & EPOLLOUT) writeReady(c);
+                        if (events[e].events & EPOLLIN && !c->closed) readRequests(c);
+                    }
                 }
             }
         }
-
-        if (sortChoice == 3) {
-            return; // Exit sorting
+        {
+            lock_guard<mutex> hold(queueLock);
+            stopping = true;
+        }
+        queueReady.notify_all();
+        for (thread &worker : workers) worker.join();
+        workers.clear();
+        ready.clear();
+        finished.clear();
+        connections.clear();
     }
+};
 
-        // Sort Order Menu
-        while (true) {
-            cout << "\nSort order:\n1 - Ascending\n2 - Descending\n3 - Return to Main Menu\n";
-            cout << "\nEnter your choice: ";
-            getline(cin, orderChoiceInput);  // Use getline to read input
+// Reads pipelined responses (see InventoryServer) from a blocking socket
+class ResponseReader {
+private:
+    int fd;
+    string input;
+    size_t begin = 0;
 
-            if (!isValidInteger(orderChoiceInput)) {  // Invalid input
-            cout << "\nInvalid input! Please enter a valid integer for order choice.\n";
-            } else {
-                orderChoice = stoi(orderChoiceInput); // Convert to integer
-                if (orderChoice >= 1 && orderChoice <= 3) {
-                    break; // Valid input, exit loop
-                } else {
-                    cout << "\nInvalid choice! Please enter a valid number between 1 and 3.\n";
+public:
+    explicit ResponseReader(int socket) : fd(socket) {}
+
+    // Wait for the next response; false if the connection broke
+    bool next(bool &ok, string_view &body) {
+        while (true) {
+            size_t newline = input.find('\n', begin);
+            if (newline != string::npos) {
+                string_view header(input.data() + begin, newline - begin);
+                size_t space = header.find(' ');
+                size_t length = 0;
+                if (space == string_view::npos
+                    || from_chars(header.data() + space + 1, header.data() + header.size(), length).ec != errc()) {
+                    return false;
                 }
+                if (input.size() - (newline + 1) >= length) {
+                    ok = header.substr(0, space) == "OK";
+                    body = string_view(input.data() + newline + 1, length);
+                    begin = newline + 1 + length;
+                    return true;
+                }
+            }
+            if (begin > 0) {
+                input.erase(0, begin);
+                begin = 0;
             }
+            char chunk[1 << 16];
+            ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            input.append(chunk, (size_t)n);
         }
+    }
+};
 
-        if (orderChoice == 3) {
-            return; // Exit sorting
+// Load generator for a running server: adds the synthetic items (existing IDs
+// are left alone), then opens config.threads connections that each send their
+// share of config.operations requests, keeping up to pipelineDepth of them in
+// flight. The mix is 80% search, 10% update-quantity, 5% update-price, and
+// 5% category or low-stock listings of at most 20 rows. Reports requests/s
+// and p50/p99/max latency from sending a request to reading its response.
+bool runLoadTest(const string &address, const WorkloadConfig &config, int pipelineDepth) {
+    WorkloadGenerator generator(config);
+    string error;
+
+    // Populate over one connection, pipelined
+    int fd = openSocket(address, false, &error);
+    if (fd < 0) {
+        cout << "Could not connect: " << error << endl;
+        return false;
+    }
+    ResponseReader populateReader(fd);
+    auto sendAll = [](int socket, const string &data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            sent += (size_t)n;
+        }
+        return true;
+    };
+    auto start = chrono::steady_clock::now();
+    int added = 0;
+    bool connected = true;
+    for (int first = 0; first < config.items && connected; first += 256) {
+        int last = min(config.items, first + 256);
+        string requests;
+        char price[32];
+        for (int i = first; i < last; i++) {
+            ItemRecord record = generator.item(i);
+            requests += "add " + record.category + " " + record.id + " \"" + record.name + "\" "
+                      + to_string(max(1, record.quantity)) + " " + string(price, formatMoney(price, record.price) - price) + "\n";
+        }
+        connected = sendAll(fd, requests);
+        for (int i = first; i < last && connected; i++) {
+            bool ok;
+            string_view body;
+            connected = populateReader.next(ok, body);
+            added += ok;
+        }
+    }
+    ::close(fd);
+    if (!connected) {
+        cout << "Connection lost while adding items" << endl;
+        return false;
+    }
+    double populateSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Added " << added << " of " << config.items << " items in " << fixed << setprecision(2)
+         << populateSeconds << " s (" << (long long)(config.items / max(populateSeconds, 1e-9)) << " requests/s)\n";
+
+    int clients = max(1, config.threads);
+    int depth = max(1, pipelineDepth);
+    vector<vector<long long>> latencies(clients); // Nanoseconds per request
+    vector<long long> errors(clients, 0);
+    atomic<bool> failed{false};
+    vector<thread> threads;
+    start = chrono::steady_clock::now();
+    for (int client = 0; client < clients; client++) {
+        threads.emplace_back([&, client] {
+            WorkloadConfig settings = config;
+            settings.seed = config.seed + 1 + (uint32_t)client;
+            WorkloadGenerator workload(settings);
+            int operations = config.operations / clients + (client < config.operations % clients);
+            string connectError;
+            int socket = openSocket(address, false, &connectError);
+            if (socket < 0) {
+                failed = true;
+                return;
+            }
+            ResponseReader reader(socket);
+            deque<chrono::steady_clock::time_point> sentAt;
+            string requests = "limit 20\n";
+            sentAt.push_back(chrono::steady_clock::now());
+            latencies[client].reserve(operations);
+            int sent = 0, received = -1; // The limit response is not counted
+            while (received < operations) {
+                while (sent < operations && (int)sentAt.size() < depth) {
+                    uint32_t roll = workload.random() % 100;
+                    string id = "SKU-" + to_string(workload.randomItem());
+                    if (roll < 80) {
+                        requests += "search " + id + "\n";
+                    } else if (roll < 90) {
+                        requests += "update-quantity " + id + " " + to_string(1 + workload.random() % 200) + "\n";
+                    } else if (roll < 95) {
+                        requests += "update-price " + id + " " + to_string(1 + workload.random() % 5000) + ".99\n";
+                    } else if (roll < 98) {
+                        requests += "list " + WorkloadGenerator::categoryName(workload.randomCategory()) + "\n";
+                    } else {
+                        requests += "low-stock 10\n";
+                    }
+                    sentAt.push_back(chrono::steady_clock::now());
+                    sent++;
+                }
+                if (!requests.empty() && !sendAll(socket, requests)) break;
+                requests.clear();
+                bool ok;
+                string_view body;
+                if (!reader.next(ok, body)) break;
+                if (received >= 0) {
+                    latencies[client].push_back(
+                        chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - sentAt.front()).count());
+                    errors[client] += !ok;
+                }
+                sentAt.pop_front();
+                received++;
+            }
+            if (received < operations) failed = true;
+            ::close(socket);
+        });
+    }
+    for (thread &worker : threads) worker.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<long long> all;
+    long long errorCount = 0;
+    for (int client = 0; client < clients; client++) {
+        all.insert(all.end(), latencies[client].begin(), latencies[client].end());
+        errorCount += errors[client];
+    }
+    if (failed) cout << "Some connections failed or broke off early\n";
+    if (all.empty()) return false;
+    sort(all.begin(), all.end());
+    auto micros = [&](double fraction) { return all[min(all.size() - 1, (size_t)(fraction * all.size()))] / 1000.0; };
+    cout << clients << " connections, pipeline depth " << depth << ": " << all.size() << " requests in " << seconds
+         << " s (" << (long long)(all.size() / max(seconds, 1e-9)) << " requests/s, " << errorCount << " errors)\n"
+         << "Latency: p50 " << micros(0.50) << " us, p99 " << micros(0.99) << " us, max " << all.back() / 1000.0 << " us" << endl;
+    return !failed;
+}
+
+InventoryServer *runningServer = nullptr;
+
+// SIGINT/SIGTERM handler while serving: stop cleanly, so the log is flushed
+void stopRunningServer(int) {
+    if (runningServer) runningServer->stop();
+}
+
+// Benchmark: quantity updates per second with no change feed, with a feed
+// nobody reads, with a subscriber that keeps up and with one that takes
+// 100 us per event. The update rate should not depend on the readers.
+void runChangeFeedBenchmark() {
+    const int itemCount = 100000;
+    const int updates = 2000000;
+    const char *labels[] = {"no feed", "feed, no readers", "fast subscriber", "slow subscriber"};
+    cout << "Change feed benchmark: " << updates << " quantity updates over " << itemCount << " items\n";
+    for (int mode = 0; mode < 4; mode++) {
+        Inventory inventory;
+        vector<string> ids(itemCount);
+        for (int i = 0; i < itemCount; i++) {
+            ids[i] = "sku-" + to_string(i);
+            inventory.addItem("SKU-" + to_string(i), "Item", 100, 1000, "Electronics");
+        }
+        atomic<long long> delivered{0};
+        unique_ptr<ChangeSubscription> subscriber;
+        if (mode >= 1) inventory.getChangeFeed();
+        if (mode == 2) {
+            subscriber.reset(new ChangeSubscription(inventory.getChangeFeed(), [&](const ChangeEvent &) { delivered++; }));
+        } else if (mode == 3) {
+            subscriber.reset(new ChangeSubscription(inventory.getChangeFeed(), [&](const ChangeEvent &) {
+                this_thread::sleep_for(chrono::microseconds(100));
+                delivered++;
+            }));
         }
 
-        // Sorting the items based on user choices
-        for (int i = 0; i < itemCount - 1; i++) {
-            for (int j = 0; j < itemCount - i - 1; j++) {
-                bool swap = false;
+        mt19937 rng(7);
+        auto start = chrono::steady_clock::now();
+        for (int u = 0; u < updates; u++) inventory.updateQuantity(ids[rng() % itemCount], (int)(rng() % 200));
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        this_thread::sleep_for(chrono::milliseconds(50)); // Let a fast subscriber catch up
+        uint64_t missed = subscriber ? subscriber->getMissed() : 0;
+        subscriber.reset();
+
+        cout << "  " << left << setw(18) << labels[mode] << right << fixed << setprecision(1)
+             << setw(8) << updates / seconds / 1e6 << " M updates/s";
+        if (mode >= 2) cout << ", " << delivered.load() << " events delivered, " << missed << " missed";
+        cout << "\n";
+    }
+    cout.flush();
+}
+
+// Benchmark: price and quantity updates from one thread while another runs
+// full reports (the total stock value) back to back, either holding a shared
+// lock on the inventory, as the server's other reads do, or walking a
+// snapshot from the version store. Locked reports stall the writer for a whole
+// report; snapshots only for the copy of a chunk now and then.
+// Check of the version commands run as a batch: `list` and `sort` freeze
+// versions that are not kept, so kept version numbers have gaps. Every version
+// `versions` lists must come back from `as-of <n>` with the quantity it had,
+// and the numbers in between must not. Returns true if no check failed.
+bool checkVersionNumbers() {
+    Inventory inventory;
+    OutputBuffer out(-1);
+    CommandProcessor processor(inventory, out);
+    // Output of one command
+    auto run = [&](const string &line) {
+        out.contents().clear();
+        processor.execute(line);
+        return out.contents();
+    };
+    // The quantity (third column) of the item's row, or empty if no row was printed
+    auto quantityIn = [](const string &output) {
+        size_t row = output.find("\nA1 ");
+        if (row == string::npos) return string();
+        return output.substr(row + 41, output.find(' ', row + 41) - row - 41);
+    };
+    run("add Clothing A1 Shirt 1 1.00");
+    unordered_map<string, string> expected; // Version number -> quantity
+    int quantity = 1;
+    for (int step = 0; step < 6; step++) {
+        string taken = run("snapshot"); // "version <n> at <time>"
+        expected[taken.substr(8, taken.find(' ', 8) - 8)] = to_string(quantity);
+        // A change, a version frozen for the reader only, and another change
+        run("update-quantity A1 " + to_string(++quantity));
+        run(step % 2 ? "list" : "sort quantity desc");
+        run("update-quantity A1 " + to_string(++quantity));
+    }
+
+    int failures = 0, listed = 0;
+    string versions = run("versions");
+    for (size_t begin = 0; begin < versions.size(); begin = versions.find('\n', begin) + 1) {
+        string number = versions.substr(begin + 8, versions.find(' ', begin + 8) - begin - 8);
+        listed++;
+        auto found = expected.find(number);
+        if (found == expected.end() || quantityIn(run("as-of " + number)) != found->second) failures++;
+        uint64_t gap = stoull(number) + 1;
+        if (!expected.count(to_string(gap)) && !quantityIn(run("as-of " + to_string(gap))).empty()) failures++;
+    }
+    if (listed != (int)expected.size()) failures++;
+    cout << listed << " versions checked, failures: " << failures << "\n"
+         << (failures == 0 ? "Version check passed." : "Version check FAILED.") << endl;
+    return failures == 0;
+}
 
-                if (sortChoice == 1) { // Quantity
-                    swap = (orderChoice == 1) ? (items[j].getQuantity() > items[j + 1].getQuantity()) : (items[j].getQuantity() < items[j + 1].getQuantity());
-                } else if (sortChoice == 2) { // Price
-                    swap = (orderChoice == 1) ? (items[j].getPrice() > items[j + 1].getPrice()) : (items[j].getPrice() < items[j + 1].getPrice());
-                } else if (sortChoice == 3) { // ID
-                    swap = (orderChoice == 1) ? (items[j].getId() > items[j + 1].getId()) : (items[j].getId() < items[j + 1].getId());
-                } else if (sortChoice == 4) { // Name
-                    swap = (orderChoice == 1) ? (items[j].getName() > items[j + 1].getName()) : (items[j].getName() < items[j + 1].getName());
+void runVersionBenchmark() {
+    const int itemCount = 200000;
+    const int updates = 500000;
+    const char *labels[] = {"no reports", "locked reports", "store, no reports", "snapshot reports"};
+    cout << "Version store benchmark: " << updates << " updates over " << itemCount << " items\n";
+    for (int mode = 0; mode < 4; mode++) {
+        Inventory inventory;
+        vector<string> ids(itemCount);
+        for (int i = 0; i < itemCount; i++) {
+            ids[i] = "sku-" + to_string(i);
+            inventory.addItem("SKU-" + to_string(i), "Item", 100, 1000, "Electronics");
+        }
+        if (mode >= 2) inventory.getVersionStore();
+        shared_mutex inventoryLock;
+        atomic<bool> writing{true};
+        atomic<long long> reports{0};
+        thread reporter;
+        if (mode == 1) {
+            reporter = thread([&] {
+                while (writing.load()) {
+                    shared_lock<shared_mutex> hold(inventoryLock);
+                    long long value = 0;
+                    for (int i = 0; i < inventory.getSlotCount(); i++) {
+                        if (inventory.isItemLive(i)) value += inventory.getItem(i).getQuantity() * inventory.getItem(i).getPrice();
+                    }
+                    if (value >= 0) reports++;
                 }
+            });
+        } else if (mode == 3) {
+            reporter = thread([&] {
+                VersionedStore &store = inventory.getVersionStore();
+                while (writing.load()) {
+                    long long value = 0;
+                    store.snapshot(false).forEachItem([&](const VersionedStore::Row &row) { value += row.quantity * row.price; });
+                    if (value >= 0) reports++;
+                }
+            });
+        }
+
+        mt19937 rng(11);
+        vector<long long> latencies(updates);
+        auto start = chrono::steady_clock::now();
+        for (int u = 0; u < updates; u++) {
+            auto begin = chrono::steady_clock::now();
+            {
+                unique_lock<shared_mutex> hold(inventoryLock);
+                if (u % 2) inventory.updateQuantity(ids[rng() % itemCount], (int)(rng() % 200));
+                else inventory.updatePrice(ids[rng() % itemCount], 500 + rng() % 1000);
+            }
+            latencies[u] = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        writing = false;
+        if (reporter.joinable()) reporter.join();
+
+        nth_element(latencies.begin(), latencies.begin() + updates * 99 / 100, latencies.end());
+        long long p99 = latencies[updates * 99 / 100];
+        long long worst = *max_element(latencies.begin(), latencies.end());
+        cout << "  " << left << setw(18) << labels[mode] << right << fixed << setprecision(2)
+             << setw(6) << updates / seconds / 1e6 << " M updates/s, p99 " << setprecision(1) << setw(7) << p99 / 1e3
+             << " us, max " << setw(8) << worst / 1e3 << " us";
+        if (mode == 1 || mode == 3) cout << ", " << reports.load() << " reports";
+        cout << "\n";
+    }
+    cout.flush();
+}
+
+// Benchmark: case-insensitive ID lookup, linear scan vs. hash index
+void runLookupBenchmark() {
+    const int sizes[] = {1000, 100000, 1000000};
+    mt19937 rng(42);
+
+    cout << left << setw(12) << "Items" << setw(20) << "Scan (ns/lookup)" << setw(20) << "Index (ns/lookup)" << endl;
+    for (int n : sizes) {
+        Inventory inventory;
+        inventory.reserve(n);
+        for (int i = 0; i < n; i++) {
+            inventory.addItem("Item-" + to_string(i), "Name " + to_string(i), 1 + i % 50, 1000 + i % 100 * 100, "Clothing");
+        }
+
+        // Keep the scan affordable at 1M items; the index gets many more queries
+        int scanQueries = max(20, 20000000 / n);
+        int indexQueries = 1000000;
+        vector<string> queries(max(scanQueries, indexQueries));
+        for (string &q : queries) {
+            q = "item-" + to_string(rng() % n);
+        }
 
-                if (swap) {
-                    // Swap IDs for display (since ID is a string, use a temporary variable)
-                    string tempId = items[j].getId();
-                    items[j].setId(items[j + 1].getId());
-                    items[j + 1].setId(tempId);
-
-                    // Swap names for display (also using a temporary variable)
-                    string tempName = items[j].getName();
-                    items[j].setName(items[j + 1].getName());
-                    items[j + 1].setName(tempName);
-
-                    // Swap quantities
-                    items[j].setQuantity(items[j].getQuantity() + items[j + 1].getQuantity());
-                    items[j + 1].setQuantity(items[j].getQuantity() - items[j + 1].getQuantity());
-                    items[j].setQuantity(items[j].getQuantity() - items[j + 1].getQuantity());
-
-                    // Swap prices
-                    items[j].setPrice(items[j].getPrice() + items[j + 1].getPrice());
-                    items[j + 1].setPrice(items[j].getPrice() - items[j + 1].getPrice());
-                    items[j].setPrice(items[j].getPrice() - items[j + 1].getPrice());
+        long long checksum = 0;
+        auto start = chrono::steady_clock::now();
+        for (int q = 0; q < scanQueries; q++) {
+            for (int i = 0; i < n; i++) {
+                if (inventory.getItem(i).getLowerId() == queries[q]) {
+                    checksum += i;
+                    break;
                 }
-            }       
+            }
         }
+        double scanNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / scanQueries;
 
-        // Displaying sorted items
-        string sortCriteria;
-        switch (sortChoice) {
-            case 1: sortCriteria = "Quantity"; break;
-            case 2: sortCriteria = "Price"; break;
-            case 3: sortCriteria = "ID"; break;
-            case 4: sortCriteria = "Name"; break;
+        start = chrono::steady_clock::now();
+        for (int q = 0; q < indexQueries; q++) {
+            int i = inventory.findItem(queries[q]);
+            if (i != -1) checksum += i;
         }
-    
-        string sortOrder = (orderChoice == 1) ? "Ascending" : "Descending";
-    
-        cout << "\nSorted Items by " << sortCriteria << " (" << sortOrder << "):\n";
-        printItemHeader();  // Call the header function here
-    
-        for (int i = 0; i < itemCount; i++) {
-            cout << setw(20) << items[i].getId() 
-                << setw(20) << items[i].getName() 
-                << setw(20) << items[i].getQuantity()
-                << setw(20) << fixed << setprecision(2) << items[i].getPrice() 
-                << setw(20) << items[i].getCategory() << endl;
+        double indexNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / indexQueries;
+
+        cout << left << setw(12) << n << setw(20) << fixed << setprecision(1) << scanNs
+             << setw(20) << indexNs << endl;
+
+        volatile long long sink = checksum; // Keep the lookups from being optimized away
+        (void)sink;
+    }
+}
+
+// Benchmark: heap memory per item with every string allocated separately (the
+// way items used to be kept) vs. the ItemStore's string arena, plus the whole
+// Inventory with its columns and indexes
+void runMemoryBenchmark() {
+    const int n = 1000000;
+    const char *categories[] = {"Clothing", "Electronics", "Entertainment"};
+    auto idOf = [](int i) { return "SKU-" + to_string(1000000 + i); };
+    auto nameOf = [](int i) { return "Product name " + to_string(i); };
+
+    struct SeparateStringsItem {
+        string id, name, category;
+        int quantity;
+        Money price;
+        virtual ~SeparateStringsItem() {}
+    };
+
+    size_t base = heapBytesInUse();
+    double separateBytes, arenaBytes, inventoryBytes;
+    {
+        vector<SeparateStringsItem> items(n);
+        unordered_map<string, int> index;
+        index.reserve(n);
+        for (int i = 0; i < n; i++) {
+            items[i].id = idOf(i);
+            items[i].name = nameOf(i);
+            items[i].category = categories[i % 3];
+            index[toLowerCase(items[i].id)] = i;
+        }
+        separateBytes = (double)(heapBytesInUse() - base) / n;
+    }
+    base = heapBytesInUse();
+    {
+        ItemStore items;
+        unordered_map<string_view, int> index;
+        items.reserve(n);
+        index.reserve(n);
+        for (int i = 0; i < n; i++) {
+            GeneralItem item;
+            string id = idOf(i), lowerId = toLowerCase(id);
+            item.setItem(id, nameOf(i), 1, 100, categories[i % 3]);
+            item.setLowerId(lowerId);
+            int handle = items.push_back(item);
+            index[items[handle].getLowerId()] = handle;
         }
+        arenaBytes = (double)(heapBytesInUse() - base) / n;
+    }
+    base = heapBytesInUse();
+    {
+        Inventory inventory;
+        inventory.reserve(n);
+        for (int i = 0; i < n; i++) inventory.addItem(idOf(i), nameOf(i), 1 + i % 50, 100 + i % 1000, categories[i % 3]);
+        inventoryBytes = (double)(heapBytesInUse() - base) / n;
+    }
 
-        cout << "\nPress Enter to go back to the Menu...\n";
-        clearInput(); // To handle the Enter key
-        cin.get(); // Wait for Enter
+    cout << left << setw(40) << "Items and ID index, separate strings" << fixed << setprecision(1) << separateBytes
+         << " bytes/item\n"
+         << setw(40) << "Items and ID index, string arena" << arenaBytes << " bytes/item\n"
+         << setw(40) << "Whole Inventory (columns, indexes)" << inventoryBytes << " bytes/item" << endl;
+}
+
+// Stress test for ConcurrentInventory: writers change quantity and price
+// together (price is always quantity * 100 + 7) and add and remove their own
+// items, while readers look items up and list categories and check that they
+// never see a torn or missing item. Returns true if no check failed.
+bool runConcurrentStress(int threadCount, double seconds) {
+    const int n = 10000;
+    const char *categories[] = {"Clothing", "Electronics", "Entertainment"};
+    ConcurrentInventory inventory;
+    for (int i = 0; i < n; i++) {
+        int quantity = i % 50;
+        inventory.addItem("S-" + to_string(i), "Stress " + to_string(i), quantity, quantity * 100 + 7, categories[i % 3]);
     }
 
-    void displayLowStockItems() {
-        int threshold = 5; // Threshold is set to 5 as per the example
-        cout << "\n============== Display Low Stock Items ==============\n";
-        cout << "Displaying Low Stock Items (Quantity 5 and below):\n";
-        printItemHeader();  // Call the header function here
+    atomic<bool> stop{false};
+    atomic<long long> reads{0}, writes{0}, failures{0};
+    vector<int> ownItems(threadCount, 0);
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            mt19937 rng(100 + t);
+            bool writer = (t % 2 == 0);
+            long long done = 0;
+            ItemRecord item;
+            int added = 0, removed = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                string id = "s-" + to_string(rng() % n);
+                if (writer) {
+                    int quantity = rng() % 1000;
+                    if (!inventory.updateItem(id, quantity, quantity * 100 + 7)) failures++;
+                    if (rng() % 8 == 0) {
+                        // Items in this thread's own key range come and go
+                        if (!inventory.addItem("T-" + to_string(t) + "-" + to_string(added++), "Temp", 1, 107, categories[t % 3])) failures++;
+                        if (added - removed > 100 && !inventory.removeItem("t-" + to_string(t) + "-" + to_string(removed++))) failures++;
+                    }
+                } else if (rng() % 1000 == 0) {
+                    vector<ItemRecord> listing = inventory.findItemsByCategory(categories[rng() % 3]);
+                    for (size_t k = 0; k < listing.size(); k++) {
+                        if (listing[k].price != listing[k].quantity * 100 + 7) failures++;
+                        if (k > 0 && compareIgnoreCase(listing[k - 1].id, listing[k].id) >= 0) failures++;
+                    }
+                } else {
+                    if (!inventory.findItem(id, item) || item.price != item.quantity * 100 + 7) failures++;
+                }
+                done++;
+            }
+            (writer ? writes : reads) += done;
+            if (writer) ownItems[t] = added - removed;
+        });
+    }
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+    stop = true;
+    for (thread &worker : threads) worker.join();
 
-        bool itemFound = false;
-        for (int i = 0; i < itemCount; i++) {
-            if (items[i].getQuantity() <= threshold) {
-                cout << left << setw(20) << items[i].getId()
-                     << setw(20) << items[i].getName()
-                     << setw(20) << items[i].getQuantity()
-                     << setw(20) << fixed << setprecision(2) << items[i].getPrice()
-                     << setw(20) << items[i].getCategory() << endl;
-                itemFound = true;
+    int expected = n;
+    for (int count : ownItems) expected += count;
+    if (inventory.getItemCount() != expected) failures++;
+
+    cout << "Threads:    " << threadCount << "\n"
+         << "Reads:      " << reads << "\n"
+         << "Writes:     " << writes << "\n"
+         << "Failures:   " << failures << "\n"
+         << (failures == 0 ? "Stress test passed." : "Stress test FAILED.") << endl;
+    return failures == 0;
+}
+
+// Benchmark: lookup/update throughput for a read-heavy and a write-heavy mix,
+// ConcurrentInventory vs. an Inventory behind one mutex, for 1..maxThreads threads
+void runConcurrentBenchmark(int maxThreads) {
+    const int n = 100000;
+    const double seconds = 0.5;
+    const char *categories[] = {"Clothing", "Electronics", "Entertainment"};
+    ConcurrentInventory concurrent;
+    Inventory locked;
+    mutex inventoryLock;
+    for (int i = 0; i < n; i++) {
+        concurrent.addItem("Item-" + to_string(i), "Name", i % 100, 100 + i % 1000, categories[i % 3]);
+        locked.addItem("Item-" + to_string(i), "Name", i % 100, 100 + i % 1000, categories[i % 3]);
+    }
+
+    // Operations per second with every thread doing readPercent% lookups and the rest updates
+    auto measure = [&](int threadCount, int readPercent, bool useConcurrent) {
+        atomic<bool> stop{false};
+        atomic<long long> total{0};
+        vector<thread> threads;
+        for (int t = 0; t < threadCount; t++) {
+            threads.emplace_back([&, t]() {
+                mt19937 rng(t + 1);
+                ItemRecord item;
+                long long done = 0;
+                while (!stop.load(memory_order_relaxed)) {
+                    string id = "item-" + to_string(rng() % n);
+                    bool read = (int)(rng() % 100) < readPercent;
+                    if (useConcurrent) {
+                        if (read) concurrent.findItem(id, item);
+                        else concurrent.updateQuantity(id, rng() % 100);
+                    } else {
+                        lock_guard<mutex> guard(inventoryLock);
+                        if (read) {
+                            int handle = locked.findItem(id);
+                            if (handle != -1) item.quantity = locked.getItem(handle).getQuantity();
+                        } else {
+                            locked.updateQuantity(id, rng() % 100);
+                        }
+                    }
+                    done++;
+                }
+                total += done;
+            });
+        }
+        this_thread::sleep_for(chrono::duration<double>(seconds));
+        stop = true;
+        for (thread &worker : threads) worker.join();
+        return total / seconds;
+    };
+
+    cout << left << setw(10) << "Threads" << setw(10) << "Reads %" << setw(20) << "Locked (ops/s)"
+         << setw(20) << "Concurrent (ops/s)" << "Speedup" << endl;
+    vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+    for (int threads : threadCounts) {
+        for (int readPercent : {95, 50}) {
+            double lockedOps = measure(threads, readPercent, false);
+            double concurrentOps = measure(threads, readPercent, true);
+            cout << left << setw(10) << threads << setw(10) << readPercent << setw(20) << fixed << setprecision(0)
+                 << lockedOps << setw(20) << concurrentOps << setprecision(2) << concurrentOps / lockedOps << endl;
+        }
+    }
+}
+
+// Benchmark: a WarehouseNetwork of 1, 2, 4 and 8 locations with 50k items
+// each. Times low stock everywhere, which fans out over maxThreads threads,
+// and the total availability of an ID, then
+// quantity updates and 1-unit transfers from maxThreads threads at once, which
+// only contend within a location. Checks that the transfers keep every unit.
+void runWarehouseBenchmark(int maxThreads) {
+    const int itemsPerLocation = 50000;
+    const int lowStockRuns = 20, availabilityRuns = 20000, updatesPerThread = 100000, transfersPerThread = 25000;
+    cout << "Warehouse benchmark: " << itemsPerLocation << " items per location, " << maxThreads << " threads\n";
+    cout << "locations  low stock everywhere  total availability       updates/s     transfers/s  units kept\n";
+    for (int locationCount : {1, 2, 4, 8}) {
+        WarehouseNetwork network(maxThreads);
+        for (int l = 0; l < locationCount; l++) {
+            int location = network.addLocation("Site-" + to_string(l));
+            for (int i = 0; i < itemsPerLocation; i++) {
+                network.receive(location, "SKU-" + to_string(i), "Item " + to_string(i), 1 + (i * 7 + l) % 200, 1000, "Electronics");
             }
         }
+        mt19937 rng(11);
+        size_t found = 0;
+        auto start = chrono::steady_clock::now();
+        for (int run = 0; run < lowStockRuns; run++) found += network.lowStockEverywhere(10).size();
+        double lowStockMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / lowStockRuns;
+        start = chrono::steady_clock::now();
+        long long units = 0;
+        for (int run = 0; run < availabilityRuns; run++) units += network.totalAvailable("sku-" + to_string(rng() % itemsPerLocation));
+        double availabilityUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / availabilityRuns;
 
-        if (!itemFound) {
-            cout << "\nNo items with quantity 5 or below.\n";
+        // Concurrent updates, then concurrent transfers
+        auto runThreads = [&](int opsPerThread, const function<void(mt19937 &)> &op) {
+            vector<thread> threads;
+            auto begin = chrono::steady_clock::now();
+            for (int t = 0; t < maxThreads; t++) {
+                threads.emplace_back([&, t] {
+                    mt19937 threadRng(100 + t);
+                    for (int k = 0; k < opsPerThread; k++) op(threadRng);
+                });
+            }
+            for (thread &worker : threads) worker.join();
+            return (double)opsPerThread * maxThreads / chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        };
+        double updateRate = runThreads(updatesPerThread, [&](mt19937 &r) {
+            network.setQuantity((int)(r() % locationCount), "sku-" + to_string(r() % itemsPerLocation), (int)(r() % 200));
+        });
+        long long unitsBefore = network.totalUnits();
+        double transferRate = 0;
+        if (locationCount > 1) {
+            transferRate = runThreads(transfersPerThread, [&](mt19937 &r) {
+                int from = (int)(r() % locationCount);
+                int to = (from + 1 + (int)(r() % (locationCount - 1))) % locationCount;
+                network.transfer("sku-" + to_string(r() % itemsPerLocation), from, to, 1);
+            });
         }
+        bool kept = network.totalUnits() == unitsBefore;
 
-        cout << "\nPress Enter to go back to the Menu...";
-        clearInput();
-        cin.get(); 
+        cout << setw(9) << locationCount << fixed << setprecision(2) << setw(18) << lowStockMs << " ms"
+             << setw(17) << availabilityUs << " us" << setw(16) << (long long)updateRate
+             << setw(16) << (long long)transferRate << setw(12) << (kept ? "yes" : "NO") << "\n";
+        volatile size_t sink = found + (size_t)units; // Keep the queries from being optimized away
+        (void)sink;
     }
-};
- 
-int main(){
+    cout.flush();
+}
+
+// Benchmark: stock transactions per second, each moving units between 24
+// random items (the deltas add up to zero), ConcurrentInventory vs. an
+// Inventory behind one mutex, for 1..maxThreads threads. Afterwards the total
+// number of units must be unchanged, since every transaction is all-or-nothing.
+void runTransactionBenchmark(int maxThreads) {
+    const int n = 100000;
+    const int itemsPerTransaction = 24;
+    const int startQuantity = 50;
+    const double seconds = 0.5;
+    const char *categories[] = {"Clothing", "Electronics", "Entertainment"};
+    ConcurrentInventory concurrent;
+    Inventory locked;
+    mutex inventoryLock;
+    for (int i = 0; i < n; i++) {
+        concurrent.addItem("Item-" + to_string(i), "Name", startQuantity, 100 + i % 1000, categories[i % 3]);
+        locked.addItem("Item-" + to_string(i), "Name", startQuantity, 100 + i % 1000, categories[i % 3]);
+    }
+
+    // Transactions per second, and how many were rejected for lack of stock
+    auto measure = [&](int threadCount, bool useConcurrent, long long &rejected) {
+        atomic<bool> stop{false};
+        atomic<long long> total{0}, failed{0};
+        vector<thread> threads;
+        for (int t = 0; t < threadCount; t++) {
+            threads.emplace_back([&, t]() {
+                mt19937 rng(t + 1);
+                vector<StockChange> changes(itemsPerTransaction);
+                long long done = 0, refused = 0;
+                while (!stop.load(memory_order_relaxed)) {
+                    // Ship from one item and receive the same amount into the next
+                    for (int k = 0; k < itemsPerTransaction; k += 2) {
+                        int delta = 1 + rng() % 20;
+                        changes[k] = {"item-" + to_string(rng() % n), -delta};
+                        changes[k + 1] = {"item-" + to_string(rng() % n), delta};
+                    }
+                    bool applied;
+                    if (useConcurrent) {
+                        applied = concurrent.applyStockChanges(changes);
+                    } else {
+                        lock_guard<mutex> guard(inventoryLock);
+                        applied = locked.applyStockChanges(changes);
+                    }
+                    if (!applied) refused++;
+                    done++;
+                }
+                total += done;
+                failed += refused;
+            });
+        }
+        this_thread::sleep_for(chrono::duration<double>(seconds));
+        stop = true;
+        for (thread &worker : threads) worker.join();
+        rejected += failed;
+        return total / seconds;
+    };
+
+    cout << left << setw(10) << "Threads" << setw(20) << "Locked (tx/s)" << setw(20) << "Concurrent (tx/s)"
+         << setw(10) << "Speedup" << "Rejected" << endl;
+    vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+    for (int threads : threadCounts) {
+        long long rejected = 0;
+        double lockedTps = measure(threads, false, rejected);
+        double concurrentTps = measure(threads, true, rejected);
+        cout << left << setw(10) << threads << setw(20) << fixed << setprecision(0) << lockedTps << setw(20)
+             << concurrentTps << setw(10) << setprecision(2) << concurrentTps / lockedTps << rejected << endl;
+    }
+
+    long long lockedUnits = 0, concurrentUnits = 0;
+    for (int i = 0; i < locked.getSlotCount(); i++) {
+        if (locked.isItemLive(i)) lockedUnits += locked.getItem(i).getQuantity();
+    }
+    for (const char *category : categories) {
+        for (const ItemRecord &item : concurrent.findItemsByCategory(category)) concurrentUnits += item.quantity;
+    }
+    long long expected = (long long)n * startQuantity;
+    cout << "Units conserved: " << (lockedUnits == expected && concurrentUnits == expected ? "yes" : "NO") << endl;
+}
+
+// Benchmark: sort and scan time for 1 to maxThreads threads on a large inventory
+void runScalingBenchmark(int maxThreads) {
+    const int n = 2000000;
+    const char *categories[] = {"Clothing", "Electronics", "Entertainment"};
+    mt19937 rng(7);
+
+    Inventory inventory;
+    inventory.reserve(n);
+    for (int i = 0; i < n; i++) {
+        inventory.addItem("Item-" + to_string(i), "Name " + to_string(rng() % 100000), rng() % 100,
+                          (Money)(rng() % 1000000), categories[rng() % 3]);
+    }
+
+    vector<int> expectedSort, expectedScan;
+    double baseline = 0;
+    cout << left << setw(10) << "Threads" << setw(16) << "Sort (ms)" << setw(16) << "Scan (ms)"
+         << setw(12) << "Speedup" << "Matches 1 thread" << endl;
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        inventory.setThreadCount(threads);
+        inventory.clearSortedViews();
+
+        auto start = chrono::steady_clock::now();
+        vector<int> sorted = inventory.getSortedView(Inventory::SORT_PRICE);
+        double sortMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        vector<int> scanned = inventory.findItemsByCategory("Electronics");
+        vector<int> lowStock = inventory.findLowStockItems(5);
+        scanned.insert(scanned.end(), lowStock.begin(), lowStock.end());
+        double scanMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        if (threads == 1) {
+            expectedSort = sorted;
+            expectedScan = scanned;
+            baseline = sortMs + scanMs;
+        }
+        bool same = sorted == expectedSort && scanned == expectedScan;
+        cout << left << setw(10) << threads << setw(16) << fixed << setprecision(1) << sortMs
+             << setw(16) << scanMs << setw(12) << setprecision(2) << baseline / (sortMs + scanMs)
+             << (same ? "yes" : "NO") << endl;
+    }
+}
+
+// Benchmark: writing a 1M-row item table with iostream manipulators and endl
+// (the old display loop) vs. the buffered TableRenderer. Output goes to /dev/null.
+void runRenderBenchmark() {
+    const int n = 1000000;
+    const char *categories[] = {"Clothing", "Electronics", "Entertainment"};
+    mt19937 rng(13);
+
+    Inventory inventory;
+    inventory.reserve(n);
+    for (int i = 0; i < n; i++) {
+        inventory.addItem("Item-" + to_string(i), "Name " + to_string(rng() % 100000), rng() % 100 + 1,
+                          (Money)(rng() % 1000000) + 1, categories[rng() % 3]);
+    }
+
+    ofstream stream("/dev/null");
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < inventory.getSlotCount(); i++) {
+        const GeneralItem &item = inventory.getItem(i);
+        stream << left << setw(20) << item.getId()
+               << setw(20) << item.getName()
+               << setw(20) << item.getQuantity()
+               << setw(20) << fixed << setprecision(2) << item.getPrice() / 100.0
+               << setw(20) << item.getCategory() << endl;
+    }
+    double streamMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    int fd = ::open("/dev/null", O_WRONLY);
+    start = chrono::steady_clock::now();
+    {
+        OutputBuffer out(fd);
+        TableRenderer table(out);
+        for (int i = 0; i < inventory.getSlotCount(); i++) table.row(inventory.getItem(i));
+    }
+    double rendererMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    ::close(fd);
+
+    cout << fixed << setprecision(1)
+         << "Rows:                  " << n << "\n"
+         << "iostream + endl (ms):  " << streamMs << "\n"
+         << "TableRenderer (ms):    " << rendererMs << "\n"
+         << "Speedup:               " << setprecision(2) << streamMs / rendererMs << "x" << endl;
+}
+
+// Benchmark: range, prefix and substring queries through the sorted views and
+// trigram index vs. full scans over 1M items
+void runQueryBenchmark() {
+    const int n = 1000000, queries = 20;
+    const char *categories[] = {"Clothing", "Electronics", "Entertainment"};
+    mt19937 rng(17);
+
+    Inventory inventory;
+    inventory.reserve(n);
+    for (int i = 0; i < n; i++) {
+        inventory.addItem("Item-" + to_string(i), "Name " + to_string(rng() % 1000000), rng() % 100 + 1,
+                          (Money)(rng() % 1000000) + 1, categories[rng() % 3]);
+    }
+    // Build the views and indexes up front so only the queries are timed
+    inventory.findItemsByPrice(0, 0);
+    inventory.findItemsByPrefix(Inventory::TEXT_ID, "");
+    inventory.findItemsContaining(Inventory::TEXT_NAME, "xyz");
+
+    auto timeQueries = [&](const function<size_t(int)> &query, size_t &matches) {
+        matches = 0;
+        auto start = chrono::steady_clock::now();
+        for (int q = 0; q < queries; q++) matches += query(q);
+        return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / queries;
+    };
+    auto scan = [&](const function<bool(const GeneralItem &)> &match) {
+        size_t found = 0;
+        for (int i = 0; i < inventory.getSlotCount(); i++) {
+            if (inventory.isItemLive(i) && match(inventory.getItem(i))) found++;
+        }
+        return found;
+    };
+
+    size_t indexed, scanned;
+    cout << left << setw(36) << "Query" << setw(16) << "Index (us)" << setw(16) << "Scan (us)" << "Matches" << endl;
+    auto report = [&](const string &name, double indexUs, double scanUs) {
+        cout << left << setw(36) << name << setw(16) << fixed << setprecision(1) << indexUs << setw(16) << scanUs
+             << indexed / queries << (indexed == scanned ? "" : " (MISMATCH)") << endl;
+    };
+
+    double indexUs = timeQueries([&](int q) { return inventory.findItemsByPrice(q * 4000, q * 4000 + 1000, "Electronics").size(); }, indexed);
+    double scanUs = timeQueries([&](int q) {
+        return scan([&](const GeneralItem &item) {
+            return item.getPrice() >= q * 4000 && item.getPrice() <= q * 4000 + 1000 && item.getCategory() == "Electronics";
+        });
+    }, scanned);
+    report("Price range in category", indexUs, scanUs);
+
+    indexUs = timeQueries([&](int q) { return inventory.findItemsByPrefix(Inventory::TEXT_ID, "item-" + to_string(q * 37 % 1000 + 100)).size(); }, indexed);
+    scanUs = timeQueries([&](int q) {
+        string prefix = "item-" + to_string(q * 37 % 1000 + 100);
+        return scan([&](const GeneralItem &item) { return startsWithIgnoreCase(item.getId(), prefix); });
+    }, scanned);
+    report("ID prefix", indexUs, scanUs);
+
+    indexUs = timeQueries([&](int q) { return inventory.findItemsContaining(Inventory::TEXT_NAME, to_string(q * 7919 % 9000 + 1000)).size(); }, indexed);
+    scanUs = timeQueries([&](int q) {
+        string text = to_string(q * 7919 % 9000 + 1000);
+        return scan([&](const GeneralItem &item) { return containsIgnoreCase(item.getName(), text); });
+    }, scanned);
+    report("Name substring", indexUs, scanUs);
+}
+
+// Benchmark: snapshot save, mapped (zero-copy) open and lookups, and a full load
+void runSnapshotBenchmark() {
+    const int n = 1000000;
+    const char *categories[] = {"Clothing", "Electronics", "Entertainment"};
+    const string path = "bench-snapshot.snap";
+    mt19937 rng(11);
+
+    Inventory inventory;
+    inventory.reserve(n);
+    for (int i = 0; i < n; i++) {
+        inventory.addItem("Item-" + to_string(i), "Name " + to_string(rng() % 100000), rng() % 100,
+                          (Money)(rng() % 1000000), categories[rng() % 3]);
+    }
+
+    auto start = chrono::steady_clock::now();
+    bool saved = inventory.saveSnapshot(path);
+    double saveMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    if (!saved) {
+        cout << "Could not write " << path << endl;
+        return;
+    }
+
+    start = chrono::steady_clock::now();
+    SnapshotView view;
+    view.open(path);
+    double openMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    const int lookups = 100000;
+    long long found = 0;
+    start = chrono::steady_clock::now();
+    for (int q = 0; q < lookups; q++) {
+        int i = view.find("item-" + to_string(rng() % n));
+        if (i != -1) found += view.quantity(i);
+    }
+    double lookupNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / lookups;
+    view.close();
+
+    Inventory loaded;
+    start = chrono::steady_clock::now();
+    loaded.loadSnapshot(path);
+    double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    struct stat info;
+    stat(path.c_str(), &info);
+    unlink(path.c_str());
+
+    cout << fixed << setprecision(1)
+         << "Items:                 " << n << "\n"
+         << "Snapshot size (MB):    " << info.st_size / 1048576.0 << "\n"
+         << "Save (ms):             " << saveMs << "\n"
+         << "Map + validate (ms):   " << openMs << "\n"
+         << "Mapped lookup (ns):    " << lookupNs << "\n"
+         << "Full load (ms):        " << loadMs << "\n"
+         << "Loaded items:          " << loaded.getItemCount() << (found > 0 ? "" : " (lookups failed)") << endl;
+}
+
+// Benchmark: logged price updates with an fsync per change vs. group commit
+void runWalBenchmark() {
+    const string path = "bench-wal.snap";
+    const int items = 1000;
+    const int updates = 2000;
+    const int groupSizes[] = {1, 16, 256};
+
+    cout << left << setw(16) << "Records/fsync" << setw(16) << "Updates/s" << endl;
+    for (int groupSize : groupSizes) {
+        unlink(path.c_str());
+        unlink((path + ".wal").c_str());
+        Inventory inventory;
+        inventory.openStorage(path);
+        for (int i = 0; i < items; i++) {
+            inventory.addItem("Item-" + to_string(i), "Name", 10, 100, "Clothing");
+        }
+        inventory.setGroupCommit(groupSize);
+
+        auto start = chrono::steady_clock::now();
+        for (int u = 0; u < updates; u++) {
+            inventory.updatePrice("item-" + to_string(u % items), (Money)(u % 500) * 100 + 50);
+        }
+        inventory.closeStorage(); // Includes the final fsync
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << left << setw(16) << groupSize << setw(16) << fixed << setprecision(0) << updates / seconds << endl;
+    }
+    unlink(path.c_str());
+    unlink((path + ".wal").c_str());
+}
+
+// Benchmark: CSV parsing and full import throughput
+void runImportBenchmark() {
+    const int rows = 2000000;
+    const string path = "bench-import.csv";
+    const char *categories[] = {"Clothing", "Electronics", "Entertainment"};
+    mt19937 rng(13);
+
+    {
+        string text = "id,name,quantity,price,category\n";
+        for (int i = 0; i < rows; i++) {
+            text += "SKU-" + to_string(i) + ",Item name " + to_string(rng() % 100000) + ","
+                  + (i % 100 == 99 ? string("n/a") : to_string(1 + rng() % 500)) + ","
+                  + to_string(1 + rng() % 9999) + "." + to_string(10 + rng() % 90) + "," + categories[rng() % 3] + "\n";
+        }
+        writeFileAtomically(path, text.data(), text.size());
+    }
+
+    auto start = chrono::steady_clock::now();
+    DelimitedReader reader(',');
+    reader.open(path);
+    vector<string_view> fields;
+    ItemRecord record;
+    string reason;
+    long long parsed = 0, valid = 0;
+    while (reader.nextRow(fields)) {
+        parsed++;
+        valid += parseItemRecord(fields, record, reason);
+    }
+    double parseSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    Inventory inventory;
+    ImportReport report;
+    start = chrono::steady_clock::now();
+    inventory.importItems(path, report);
+    double importSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    unlink(path.c_str());
+
+    cout << fixed << setprecision(0)
+         << "Rows:                  " << rows << " (" << valid << " valid)\n"
+         << "Parse only (rows/s):   " << parsed / parseSeconds << "\n"
+         << "Full import (rows/s):  " << report.rowsRead / importSeconds << "\n"
+         << "Items added:           " << report.itemsAdded << "\n"
+         << "Rows rejected:         " << report.rowsRejected << endl;
+}
+
+int main(int argc, char *argv[]){
+    int threadCount = 1;
+    string loadPath, dataPath, importPath, batchPath, serveAddress, loadTestAddress;
+    int groupCommit = 1;
+    int pageSize = 100;
+    WorkloadConfig workload;
+    bool benchSuite = false;
+    int pipelineDepth = 16;
+    int historySeconds = -1; // -1: no version history unless a command asks for one
+    int historyVersions = 64;
+    for (int arg = 1; arg < argc; arg++) {
+        string option = argv[arg];
+        if (option == "--threads" && arg + 1 < argc && isValidInteger(argv[arg + 1])) {
+            threadCount = max(1, stoi(argv[++arg]));
+        } else if (option == "--load" && arg + 1 < argc) {
+            loadPath = argv[++arg];
+        } else if (option == "--data" && arg + 1 < argc) {
+            dataPath = argv[++arg];
+        } else if (option == "--group-commit" && arg + 1 < argc && isValidInteger(argv[arg + 1])) {
+            groupCommit = max(1, stoi(argv[++arg]));
+        } else if (option == "--import" && arg + 1 < argc) {
+            importPath = argv[++arg];
+        } else if (option == "--batch" && arg + 1 < argc) {
+            batchPath = argv[++arg];
+        } else if (option == "--page-size" && arg + 1 < argc && isValidInteger(argv[arg + 1])) {
+            pageSize = max(0, stoi(argv[++arg]));
+        } else if (option == "--items" && arg + 1 < argc && isValidInteger(argv[arg + 1])) {
+            workload.items = max(1, stoi(argv[++arg]));
+        } else if (option == "--categories" && arg + 1 < argc && isValidInteger(argv[arg + 1])) {
+            workload.categories = max(1, stoi(argv[++arg]));
+        } else if (option == "--skew" && arg + 1 < argc && isValidFloat(argv[arg + 1])) {
+            workload.skew = stod(argv[++arg]);
+        } else if (option == "--ops" && arg + 1 < argc && isValidInteger(argv[arg + 1])) {
+            workload.operations = max(1, stoi(argv[++arg]));
+        } else if (option == "--seed" && arg + 1 < argc && isValidInteger(argv[arg + 1])) {
+            workload.seed = (uint32_t)stoul(argv[++arg]);
+        } else if (option == "--serve" && arg + 1 < argc) {
+            serveAddress = argv[++arg];
+        } else if (option == "--load-test" && arg + 1 < argc) {
+            loadTestAddress = argv[++arg]; // Runs once all options are read, like --bench-suite
+        } else if (option == "--pipeline" && arg + 1 < argc && isValidInteger(argv[arg + 1])) {
+            pipelineDepth = max(1, stoi(argv[++arg]));
+        } else if (option == "--history" && arg + 1 < argc && isValidInteger(argv[arg + 1])) {
+            historySeconds = stoi(argv[++arg]);
+        } else if (option == "--history-versions" && arg + 1 < argc && isValidInteger(argv[arg + 1])) {
+            historyVersions = max(1, stoi(argv[++arg]));
+        } else if (option == "--bench-suite") {
+            benchSuite = true; // Runs once all options are read, so the workload options may come after it
+        } else if (option == "--bench-query") {
+            runQueryBenchmark();
+            return 0;
+        } else if (option == "--bench-render") {
+            runRenderBenchmark();
+            return 0;
+        } else if (option == "--bench-import") {
+            runImportBenchmark();
+            return 0;
+        } else if (option == "--bench-wal") {
+            runWalBenchmark();
+            return 0;
+        } else if (option == "--bench-snapshot") {
+            runSnapshotBenchmark();
+            return 0;
+        } else if (option == "--bench-changes") {
+            runChangeFeedBenchmark();
+            return 0;
+        } else if (option == "--bench-versions") {
+            runVersionBenchmark();
+            return 0;
+        } else if (option == "--bench-lookup") {
+            runLookupBenchmark();
+            return 0;
+        } else if (option == "--bench-memory") {
+            runMemoryBenchmark();
+            return 0;
+        } else if (option == "--check-versions") {
+            return checkVersionNumbers() ? 0 : 1;
+        } else if (option == "--stress-concurrent") {
+            int stressThreads = threadCount > 1 ? threadCount : (int)max(4u, thread::hardware_concurrency());
+            return runConcurrentStress(stressThreads, 2.0) ? 0 : 1;
+        } else if (option == "--bench-concurrent") {
+            int maxThreads = threadCount > 1 ? threadCount : (int)max(1u, thread::hardware_concurrency());
+            runConcurrentBenchmark(maxThreads);
+            return 0;
+        } else if (option == "--bench-warehouses") {
+            int maxThreads = threadCount > 1 ? threadCount : (int)max(1u, thread::hardware_concurrency());
+            runWarehouseBenchmark(maxThreads);
+            return 0;
+        } else if (option == "--bench-transactions") {
+            int maxThreads = threadCount > 1 ? threadCount : (int)max(1u, thread::hardware_concurrency());
+            runTransactionBenchmark(maxThreads);
+            return 0;
+        } else if (option == "--bench-scaling") {
+            int maxThreads = threadCount > 1 ? threadCount : (int)max(1u, thread::hardware_concurrency());
+            runScalingBenchmark(maxThreads);
+            return 0;
+        } else {
+            cout << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+
+    if (benchSuite) {
+        workload.threads = threadCount;
+        runBenchmarkSuite(workload);
+        return 0;
+    }
+    if (!loadTestAddress.empty()) {
+        workload.threads = threadCount;
+        return runLoadTest(loadTestAddress, workload, pipelineDepth) ? 0 : 1;
+    }
+
     Inventory inventory;
+    inventory.setThreadCount(threadCount);
+    inventory.setPageSize(pageSize);
+    if (!dataPath.empty()) {
+        string error;
+        if (!inventory.openStorage(dataPath, &error)) {
+            cout << "Could not open inventory storage: " << error << endl;
+            return 1;
+        }
+        inventory.setGroupCommit(groupCommit);
+    }
+    if (!loadPath.empty()) {
+        string error;
+        if (!inventory.loadSnapshot(loadPath, &error)) {
+            cout << "Could not load inventory: " << error << endl;
+            return 1;
+        }
+    }
+    if (!importPath.empty()) {
+        ImportReport report;
+        if (!inventory.importItems(importPath, report)) {
+            cout << "Could not open " << importPath << endl;
+            return 1;
+        }
+        cout << report.itemsAdded << " of " << report.rowsRead << " rows imported from " << importPath << ".\n";
+        for (const string &error : report.errors) cout << error << "\n";
+        if (report.rowsRejected > (long long)report.errors.size()) {
+            cout << "... and " << report.rowsRejected - report.errors.size() << " more rejected rows.\n";
+        }
+    }
+    if (historySeconds >= 0) {
+        inventory.getVersionStore().setHistory(historyVersions, chrono::seconds(historySeconds));
+    }
+    if (!serveAddress.empty()) {
+        // The --threads workers run requests; each request runs on one thread
+        inventory.setThreadCount(1);
+        inventory.getChangeFeed(); // Started up front: "changes" requests only read it
+        inventory.getVersionStore(); // Likewise for full listings and the version commands
+        InventoryServer server(inventory);
+        string error;
+        if (!server.listen(serveAddress, &error)) {
+            cout << "Could not start the server: " << error << endl;
+            return 1;
+        }
+        runningServer = &server;
+        signal(SIGINT, stopRunningServer);
+        signal(SIGTERM, stopRunningServer);
+        cout << "Serving " << inventory.getItemCount() << " items on " << serveAddress << " with " << threadCount
+             << (threadCount == 1 ? " worker" : " workers") << endl;
+        server.run(threadCount);
+        runningServer = nullptr;
+        if (serveAddress.find('/') != string::npos) ::unlink(serveAddress.c_str());
+        cout << "Server stopped" << endl;
+        return 0;
+    }
+    if (!batchPath.empty()) {
+        // Run commands from a file (or stdin for "-") instead of the menu
+        OutputBuffer out;
+        CommandProcessor processor(inventory, out);
+        if (batchPath == "-") {
+            ios::sync_with_stdio(false);
+            processor.run(cin);
+        } else {
+            ifstream in(batchPath);
+            if (!in) {
+                cout << "Could not open " << batchPath << endl;
+                return 1;
+            }
+            processor.run(in);
+        }
+        return processor.getErrorCount() == 0 ? 0 : 2;
+    }
+
     string choice_str;
     int choice;
 
     do {
     cout << "\n================== Inventory Management System ==================\n";
-    cout << "\n1 - Add Item\n2 - Update Item\n3 - Remove Item\n4 - Display Items by Category\n5 - Display All Items\n6 - Search Item\n7 - Sort Items\n8 - Display Low Stock Items\n9 - Exit\n";
+    cout << "\n1 - Add Item\n2 - Update Item\n3 - Remove Item\n4 - Display Items by Category\n5 - Display All Items\n6 - Search Item\n7 - Sort Items\n8 - Display Low Stock Items\n9 - Save Inventory\n10 - Load Inventory\n11 - Import Items\n12 - Inventory Value\n13 - Set Reorder Threshold\n14 - Stock Movement\n15 - Exit\n";
     cout << "\nEnter your choice: ";
     cin >> choice_str;
 
     if (!isValidInteger(choice_str)) {
-            cout << "Invalid input! Please enter a valid number between 1 and 9." << endl;
+            cout << "Invalid input! Please enter a valid number between 1 and 15." << endl;
             continue;
         }
 
     // Convert string to integer after validation
         choice = stoi(choice_str);
 
+        bool changesItems = choice == 1 || choice == 2 || choice == 3 || choice == 10 || choice == 11 || choice == 13
+            || choice == 14;
+        if (changesItems && inventory.hasStorageFailed()) {
+            cout << "\nThe write-ahead log has failed, so changes can no longer be saved. Restart to recover." << endl;
+            continue;
+        }
+
         switch(choice){
             case 1:
                 inventory.addItem();
@@ -618,13 +7692,34 @@ int main(){
                 inventory.displayLowStockItems();
                 break;
             case 9:
+                inventory.saveInventory();
+                break;
+            case 10:
+                inventory.loadInventory();
+                break;
+            case 11:
+                inventory.importItemsFromFile();
+                break;
+            case 12:
+                inventory.displayInventoryValue();
+                break;
+            case 13:
+                inventory.setReorderThreshold();
+                break;
+            case 14:
+                inventory.recordStockMovement();
+                break;
+            case 15:
                 cout << "\nThank you for using Inventory Management System!\nExiting the system. Goodbye!" << endl;
                 break;
             default:
                 cout << "\nInvalid choice! Please enter a valid option." << endl;
                 break;
         }
-    } while (true && choice != 9);
+        if (changesItems && inventory.hasStorageFailed()) {
+            cout << "\nThe change could not be written to the write-ahead log and is not saved." << endl;
+        }
+    } while (true && choice != 15);
 
     return 0;
 }
\ No newline at end of file